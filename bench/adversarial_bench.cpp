@@ -0,0 +1,168 @@
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+using namespace std;
+
+#include "preprocessor/preprocessor_lexer.h"
+#include "bench_util.h"
+
+//Each input is lexed at its full size and at a quarter of it. Linear lexing takes four
+//times as long on the full size input, quadratic lexing sixteen times. Anything growing
+//faster than n^max_scaling_exponent fails, which leaves plenty of margin for noise.
+const size_t scale_factor = 4;
+const double max_scaling_exponent = 1.5;
+
+//Each size is timed this many times and the best time taken
+const int num_runs = 5;
+
+//Streamed inputs are read in small chunks, so that anything which copies the window
+//each time it's refilled shows up
+const size_t stream_chunk_size = 4096;
+
+//An input built to hit the worst case of one part of the lexer, made of a repeated
+//pattern between a prefix and a suffix
+struct adversarial_input
+{
+  const char *name;
+  const char *prefix;
+  const char *pattern;
+  const char *suffix;
+  size_t repeats;
+  unsigned int flags;
+  bool stream;
+};
+
+const adversarial_input inputs[] =
+{
+  //Line splices are deleted one after another as part of transforming a single character
+  { "line splices", "a", "\\\n", "b\n", 10000000, PPLEX_DEFAULT, false },
+  { "trigraph line splices", "a", "?\?/\n", "b\n", 10000000, PPLEX_DEFAULT, false },
+  { "splices in a comment", "/*", "*\\\n", "/\n", 3000000, PPLEX_DEFAULT, false },
+  { "splices opening a comment", "/", "\\\n", "**/\n", 3000000, PPLEX_DEFAULT, true },
+
+  //Characters which decide their token from the next one look past the splices after them
+  { "splices after a dot", ".", "\\\n", "5\n", 3000000, PPLEX_DEFAULT, false },
+  { "streamed splices after <:", "<:", "\\\n", ":\\\n:\n", 3000000, PPLEX_DEFAULT, true },
+
+  //Each ? looks two characters ahead for a trigraph
+  { "question marks", "", "?", "\n", 10000000, PPLEX_DEFAULT, false },
+  { "almost trigraphs", "", "??a", "\n", 3000000, PPLEX_DEFAULT, false },
+
+  //A pp-number is one token however many character groups it's made of
+  { "pp-number digits", "1", "0", "\n", 1000000, PPLEX_DEFAULT, false },
+  { "pp-number groups", "1", "e+.x", "\n", 1000000, PPLEX_DEFAULT, false },
+
+  //Text which keeps looking like the start or end of another comment
+  { "comment-like text", "/*", "/* // * ", "*/\n", 1000000, PPLEX_DEFAULT, false },
+  { "line comment-like text", "//", "/* // * ", "\n", 1000000, PPLEX_DEFAULT, false },
+
+  //A \u or \U which turns out not to start a universal-character-name is rewound over,
+  //after the character following it has already been decoded
+  { "incomplete UCN in a literal", "", "\"\\u\xC3\xA9\" ", "\n", 1000000, PPLEX_DEFAULT, false },
+  { "incomplete UCN", "", "x\\u1\xC3\xA9 ", "\n", 1000000, PPLEX_DEFAULT, false },
+
+  //The lexer saves a position to rewind to while deciding whether this is a header name
+  { "streamed header name", "#include <", "a", ">\n", 10000000, PPLEX_DEFAULT, true },
+
+  //Characters which aren't well formed UTF-8 are appended to the literal one at a time,
+  //each followed by a run which can be copied, and the terminator is never found
+  { "unterminated raw string", "R\"(", "\xC0\x80" "a", "", 1000000, PPLEX_RECOVER_ERRORS, false }
+};
+
+/**
+ * Builds an input with the specified number of repeats of its pattern.
+ */
+string build_input(const adversarial_input &input, size_t repeats)
+{
+  string source = input.prefix;
+  size_t pattern_length = strlen(input.pattern);
+
+  source.reserve(source.length() + pattern_length * repeats + strlen(input.suffix));
+
+  for(size_t i = 0; i < repeats; i++)
+    source.append(input.pattern, pattern_length);
+
+  source += input.suffix;
+
+  return source;
+}
+
+/**
+ * Lexes the whole of the source, returning the best time taken over a few runs.
+ */
+double time_lexing(const string &source, unsigned int flags, bool stream)
+{
+  double best = 1e9;
+
+  for(int run = 0; run < num_runs; run++)
+  {
+    istringstream source_stream(source);
+    bench_timer timer;
+    preprocessor_token tokens[256];
+
+    if(stream)
+    {
+      preprocessor_lexer lexer(source_stream, stream_chunk_size, flags);
+
+      while(lexer.next_tokens(tokens, 256))
+        ;
+    }
+    else
+    {
+      preprocessor_lexer lexer(source.data(), source.length(), flags);
+
+      while(lexer.next_tokens(tokens, 256))
+        ;
+    }
+
+    best = min(best, timer.elapsed_seconds());
+  }
+
+  return best;
+}
+
+/**
+ * Lexes inputs crafted to hit the worst cases of the lexer, each at two sizes, and fails
+ * if the time taken grows faster than linearly with the size of any of them. An input
+ * which needs stack in proportion to its size crashes instead.
+ */
+int main()
+{
+  bool superlinear = false;
+
+  cout << "adversarial inputs, scaling from 1/" << scale_factor << " size to full size" << endl;
+  cout << "  " << left << setw(26) << "input" << right << setw(10) << "size"
+       << setw(12) << "small" << setw(12) << "full" << setw(12) << "throughput"
+       << setw(10) << "exponent" << endl;
+
+  for(const adversarial_input &input : inputs)
+  {
+    string small_source = build_input(input, input.repeats / scale_factor);
+    string full_source = build_input(input, input.repeats);
+
+    double small_time = time_lexing(small_source, input.flags, input.stream);
+    double full_time = time_lexing(full_source, input.flags, input.stream);
+
+    //Very fast runs are dominated by noise, so are never counted as superlinear
+    double exponent = log(max(full_time, 1e-3) / max(small_time, 1e-3 / scale_factor)) / log(scale_factor);
+    bool failed = exponent > max_scaling_exponent;
+
+    cout << "  " << left << setw(26) << input.name << right
+         << setw(7) << full_source.length() / (1024 * 1024) << " MB"
+         << fixed << setprecision(1)
+         << setw(9) << small_time * 1e3 << " ms"
+         << setw(9) << full_time * 1e3 << " ms"
+         << setw(7) << full_source.length() / full_time / (1024 * 1024) << " MB/s"
+         << setprecision(2) << setw(10) << exponent
+         << (failed ? "  SUPERLINEAR" : "") << endl;
+
+    superlinear = superlinear || failed;
+  }
+
+  return superlinear ? EXIT_FAILURE : EXIT_SUCCESS;
+}
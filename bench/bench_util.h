@@ -0,0 +1,119 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <string>
+#include <chrono>
+#include <cstdint>
+using std::string;
+
+//Deterministic pseudo random number generator so every run lexes the same input
+class bench_random
+{
+private:
+  uint64_t mState;
+
+public:
+  bench_random(uint64_t seed) : mState(seed) {}
+
+  unsigned int next(unsigned int bound)
+  {
+    mState = mState * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (unsigned int)(mState >> 33) % bound;
+  }
+};
+
+/**
+ * Generates roughly the specified number of bytes of ordinary looking C++ source: plain
+ * ASCII declarations, expressions, literals and comments, with no trigraphs, UCNs or
+ * line splices.
+ */
+inline string generate_ordinary_source(size_t length)
+{
+  static const char *const types[] = { "int", "unsigned long", "const char *", "std::vector<int>", "double", "bool" };
+  static const char *const names[] = { "count", "buffer_size", "mCurrPosition", "result", "index", "tokenCount", "first_char", "i" };
+  static const char *const ops[] = { " + ", " - ", " * ", " << ", " == ", " && ", " != ", "->", "." };
+
+  bench_random rng(42);
+  string source;
+  source.reserve(length + 256);
+
+  source += "// Copyright (C) 2013 Example Corporation. All rights reserved.\n"
+            "// Licensed under the terms of the accompanying licence file.\n\n";
+
+  while(source.length() < length)
+  {
+    switch(rng.next(6))
+    {
+      case 0:
+        source += "/**\n * Computes the ";
+        source += names[rng.next(8)];
+        source += " for the current position within the input buffer.\n */\n";
+        break;
+
+      case 1:
+        source += "  ";
+        source += types[rng.next(6)];
+        source += " ";
+        source += names[rng.next(8)];
+        source += " = ";
+        source += std::to_string(rng.next(100000));
+        source += ";\n";
+        break;
+
+      case 2:
+        source += "  if(";
+        source += names[rng.next(8)];
+        source += ops[rng.next(9)];
+        source += names[rng.next(8)];
+        source += ")\n    return 0x";
+        source += std::to_string(rng.next(4096));
+        source += "u;\n";
+        break;
+
+      case 3:
+        source += "  printf(\"value of ";
+        source += names[rng.next(8)];
+        source += " is %d\\n\", ";
+        source += names[rng.next(8)];
+        source += "); // trace\n";
+        break;
+
+      case 4:
+        source += "  ";
+        source += names[rng.next(8)];
+        source += " += ";
+        source += names[rng.next(8)];
+        source += "[";
+        source += std::to_string(rng.next(64));
+        source += "] * 1.5e3;\n";
+        break;
+
+      default:
+        source += "\n  for(int i = 0; i < ";
+        source += names[rng.next(8)];
+        source += "; i++)\n  {\n    ";
+        source += names[rng.next(8)];
+        source += "++;\n  }\n";
+        break;
+    }
+  }
+
+  return source;
+}
+
+//Wall clock timer
+class bench_timer
+{
+private:
+  std::chrono::steady_clock::time_point mStart;
+
+public:
+  bench_timer() : mStart(std::chrono::steady_clock::now()) {}
+
+  double elapsed_seconds() const
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - mStart).count();
+  }
+};
+
+#endif //BENCH_UTIL_H
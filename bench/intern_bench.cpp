@@ -0,0 +1,164 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <cstdlib>
+using namespace std;
+
+#include "preprocessor/preprocessor_lexer.h"
+#include "preprocessor/identifier_table.h"
+#include "preprocessor/concurrent_identifier_table.h"
+#include "bench_util.h"
+
+const unsigned int thread_counts[] = { 1, 2, 4, 8, 16, 32, 64 };
+
+//Number of identifiers each thread interns
+const size_t identifiers_per_thread = 1000000;
+
+/**
+ * Generates the identifiers one thread interns, as a single buffer of spellings
+ * separated by spaces. Most are drawn from a vocabulary common to every thread, like the
+ * names from the standard library and project headers every file includes, and the rest
+ * are the thread's own.
+ */
+string generate_identifiers(unsigned int thread)
+{
+  static const char *const common_roots[] = { "std", "size_t", "vector", "string", "mCurrPosition", "result", "index", "uint32_t" };
+
+  bench_random rng(1000 + thread);
+  string identifiers;
+
+  for(size_t i = 0; i < identifiers_per_thread; i++)
+  {
+    if(rng.next(10) < 8)
+    {
+      identifiers += common_roots[rng.next(8)];
+      identifiers += "_";
+      identifiers += to_string(rng.next(500));
+    }
+    else
+    {
+      identifiers += "local";
+      identifiers += to_string(thread);
+      identifiers += "_";
+      identifiers += to_string(rng.next(20000));
+    }
+
+    identifiers += " ";
+  }
+
+  return identifiers;
+}
+
+/**
+ * Interns each space separated identifier of the buffer in the specified table.
+ */
+template<typename Table>
+void intern_identifiers(Table &table, const string &identifiers)
+{
+  for(size_t start = 0, end; start < identifiers.length(); start = end + 1)
+  {
+    end = identifiers.find(' ', start);
+    table.intern(identifiers.data() + start, end - start);
+  }
+}
+
+//identifier_table serialised with a mutex, to compare the concurrent table against
+class locked_identifier_table
+{
+private:
+  identifier_table mTable;
+  mutex mMutex;
+
+public:
+  symbol_id intern(const char *spelling, size_t length)
+  {
+    lock_guard<mutex> lock(mMutex);
+    return mTable.intern(spelling, length);
+  }
+};
+
+/**
+ * Runs one thread per buffer of identifiers, each interning its identifiers in the
+ * table, and returns the elapsed time.
+ */
+template<typename Table>
+double run_threads(Table &table, const vector<string> &inputs, unsigned int num_threads)
+{
+  vector<thread> threads;
+  bench_timer timer;
+
+  for(unsigned int i = 0; i < num_threads; i++)
+    threads.emplace_back([&table, &inputs, i]() { intern_identifiers(table, inputs[i]); });
+
+  for(thread &t : threads)
+    t.join();
+
+  return timer.elapsed_seconds();
+}
+
+/**
+ * Runs one thread per source file, each lexing its file with identifiers interned in the
+ * process wide table, and returns the elapsed time.
+ */
+double run_lexers(const vector<string> &sources, unsigned int num_threads)
+{
+  vector<thread> threads;
+  bench_timer timer;
+
+  for(unsigned int i = 0; i < num_threads; i++)
+  {
+    threads.emplace_back([&sources, i]()
+    {
+      preprocessor_lexer lexer(sources[i].data(), sources[i].length(), PPLEX_SHARED_IDENTIFIERS);
+      preprocessor_token tokens[256];
+
+      while(lexer.next_tokens(tokens, 256))
+        ;
+    });
+  }
+
+  for(thread &t : threads)
+    t.join();
+
+  return timer.elapsed_seconds();
+}
+
+int main()
+{
+  const unsigned int max_threads = thread_counts[sizeof(thread_counts) / sizeof(thread_counts[0]) - 1];
+  vector<string> inputs;
+  vector<string> sources;
+
+  for(unsigned int i = 0; i < max_threads; i++)
+    inputs.push_back(generate_identifiers(i));
+
+  for(unsigned int i = 0; i < max_threads; i++)
+    sources.push_back(generate_ordinary_source(1024 * 1024));
+
+  cout << "interning " << identifiers_per_thread << " identifiers per thread, "
+       << thread::hardware_concurrency() << " hardware threads" << endl;
+  cout << "  " << setw(7) << "threads" << setw(16) << "concurrent" << setw(16) << "locked"
+       << setw(16) << "lexing" << endl;
+
+  for(unsigned int num_threads : thread_counts)
+  {
+    concurrent_identifier_table concurrent;
+    locked_identifier_table locked;
+
+    double concurrent_time = run_threads(concurrent, inputs, num_threads);
+    double locked_time = run_threads(locked, inputs, num_threads);
+    double lexing_time = run_lexers(sources, num_threads);
+    double total = (double)identifiers_per_thread * num_threads;
+
+    cout << "  " << setw(7) << num_threads
+         << fixed << setprecision(1)
+         << setw(12) << total / concurrent_time / 1e6 << " M/s"
+         << setw(12) << total / locked_time / 1e6 << " M/s"
+         << setw(11) << num_threads / lexing_time << " MB/s" << endl;
+  }
+
+  return EXIT_SUCCESS;
+}
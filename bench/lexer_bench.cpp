@@ -0,0 +1,397 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+#include "preprocessor/preprocessor_lexer.h"
+#include "preprocessor/token_buffer.h"
+#include "preprocessor/identifier_table.h"
+#include "util/byte_scan.h"
+#include "bench_util.h"
+
+/**
+ * Lexes the whole input a batch of tokens at a time, returning the number of tokens
+ * produced.
+ */
+template<typename Lexer>
+size_t lex_all(const string &input, unsigned int flags)
+{
+  Lexer lexer(input.data(), input.length(), flags);
+  preprocessor_token tokens[256];
+  size_t num_tokens = 0;
+
+  while(size_t batch_size = lexer.next_tokens(tokens, 256))
+    num_tokens += batch_size;
+
+  return num_tokens;
+}
+
+/**
+ * Lexes the whole input a batch of tokens at a time, interning the identifiers, and
+ * returns the number of tokens produced.
+ */
+template<typename Lexer>
+size_t intern_all(const string &input, unsigned int flags)
+{
+  identifier_table identifiers;
+  Lexer lexer(input.data(), input.length(), flags);
+  preprocessor_token tokens[256];
+  size_t num_tokens = 0;
+
+  lexer.intern_identifiers(identifiers);
+
+  while(size_t batch_size = lexer.next_tokens(tokens, 256))
+    num_tokens += batch_size;
+
+  return num_tokens;
+}
+
+/**
+ * Lexes the whole input a token at a time, returning the number of tokens produced.
+ */
+template<typename Lexer>
+size_t lex_each(const string &input, unsigned int flags)
+{
+  Lexer lexer(input.data(), input.length(), flags);
+  size_t num_tokens = 0;
+
+  while(!lexer.finished_tokenising())
+  {
+    lexer.next_token();
+    ++num_tokens;
+  }
+
+  return num_tokens;
+}
+
+//Tokens which a parser skips over
+const unsigned int insignificant_tokens = token_type_bit(PPTOK_WHITESPACE) | token_type_bit(PPTOK_NEW_LINE);
+
+/**
+ * As tokenise_all, but with the spellings, token arrays and selected indices all
+ * allocated from an arena for the translation unit which is released in one go.
+ */
+template<typename Lexer>
+size_t tokenise_all_in_arena(const string &input, unsigned int flags)
+{
+  arena memory;
+  Lexer lexer(input.data(), input.length(), flags);
+  token_buffer tokens(memory);
+  arena_vector<uint32_t> significant(&memory);
+
+  lexer.use_arena(memory);
+  lexer.tokenise(tokens);
+  tokens.select(~insignificant_tokens, significant);
+
+  return tokens.size();
+}
+
+//Token sink which only counts the tokens pushed to it
+struct counting_sink
+{
+  size_t num_tokens = 0;
+
+  void on_whitespace() { ++num_tokens; }
+  void on_new_line() { ++num_tokens; }
+  void on_header_name(token_spelling) { ++num_tokens; }
+  void on_identifier(token_spelling, preprocessor_keyword, symbol_id) { ++num_tokens; }
+  void on_number(token_spelling) { ++num_tokens; }
+  void on_literal(preprocessor_token_type, token_spelling) { ++num_tokens; }
+  void on_punctuator(preprocessor_punctuator) { ++num_tokens; }
+  void on_non_whitespace_char(token_spelling) { ++num_tokens; }
+  void on_eof() { ++num_tokens; }
+  void on_invalid(token_spelling) { ++num_tokens; }
+};
+
+/**
+ * Pushes the whole input to a counting sink, returning the number of tokens produced.
+ */
+template<typename Lexer>
+size_t push_all(const string &input, unsigned int flags)
+{
+  Lexer lexer(input.data(), input.length(), flags);
+  counting_sink sink;
+
+  lexer.push_tokens(sink);
+
+  return sink.num_tokens;
+}
+
+#ifdef __cpp_impl_coroutine
+
+/**
+ * Pulls every token of the input from a coroutine generator, returning the number of
+ * tokens produced.
+ */
+template<typename Lexer>
+size_t generate_all(const string &input, unsigned int flags)
+{
+  Lexer lexer(input.data(), input.length(), flags);
+  size_t num_tokens = 0;
+
+  for(const preprocessor_token &tok : lexer.generate_tokens())
+  {
+    (void)tok;
+    ++num_tokens;
+  }
+
+  return num_tokens;
+}
+
+#endif
+
+/**
+ * Tokenises the whole input into a token buffer, then selects the tokens which aren't
+ * whitespace or new-lines as a parser would. Returns the number of tokens produced.
+ */
+template<typename Lexer>
+size_t tokenise_all(const string &input, unsigned int flags)
+{
+  Lexer lexer(input.data(), input.length(), flags);
+  token_buffer tokens;
+  arena_vector<uint32_t> significant;
+
+  lexer.tokenise(tokens);
+  tokens.select(~insignificant_tokens, significant);
+
+  return tokens.size();
+}
+
+/**
+ * Selects the indices of the significant tokens in an array of whole tokens, as
+ * token_buffer::select does from the array of types alone.
+ */
+void select_significant(const vector<preprocessor_token> &tokens, vector<uint32_t> &indices)
+{
+  for(size_t i = 0; i < tokens.size(); i++)
+  {
+    if(!(insignificant_tokens & token_type_bit(tokens[i].type)))
+      indices.push_back(i);
+  }
+}
+
+/**
+ * Lexes the whole input into an array of whole tokens a batch at a time, then selects the
+ * significant tokens from it. The array of structures counterpart to tokenise_all.
+ */
+template<typename Lexer>
+size_t token_vector_all(const string &input, unsigned int flags)
+{
+  Lexer lexer(input.data(), input.length(), flags);
+  vector<preprocessor_token> tokens;
+  vector<uint32_t> significant;
+  preprocessor_token batch[256];
+
+  tokens.reserve(input.length() / 3 + 1);
+
+  while(size_t batch_size = lexer.next_tokens(batch, 256))
+    tokens.insert(tokens.end(), batch, batch + batch_size);
+
+  select_significant(tokens, significant);
+
+  return tokens.size();
+}
+
+//A lexer configuration to benchmark
+struct lexer_mode
+{
+  const char *name;
+  unsigned int flags;
+  size_t (*lex)(const string &input, unsigned int flags);
+  bool ascii_only;
+};
+
+const lexer_mode modes[] =
+{
+  { "default", PPLEX_DEFAULT, lex_all<preprocessor_lexer>, false },
+  { "token-at-a-time", PPLEX_DEFAULT, lex_each<preprocessor_lexer>, false },
+  { "interned-identifiers", PPLEX_DEFAULT, intern_all<preprocessor_lexer>, false },
+  { "push-sink", PPLEX_DEFAULT, push_all<preprocessor_lexer>, false },
+#ifdef __cpp_impl_coroutine
+  { "coroutine-generator", PPLEX_DEFAULT, generate_all<preprocessor_lexer>, false },
+#endif
+  { "no-clean-block-fast-path", PPLEX_NO_CLEAN_BLOCK_FAST_PATH, lex_all<preprocessor_lexer>, false },
+  { "structural-index", PPLEX_STRUCTURAL_INDEX, lex_all<preprocessor_lexer>, false },
+  { "ascii-specialisation", PPLEX_DEFAULT, lex_all<ascii_preprocessor_lexer>, true },
+  { "ascii-structural-index", PPLEX_STRUCTURAL_INDEX, lex_all<ascii_preprocessor_lexer>, true },
+  { "token-vector", PPLEX_DEFAULT, token_vector_all<preprocessor_lexer>, false },
+  { "token-buffer", PPLEX_DEFAULT, tokenise_all<preprocessor_lexer>, false },
+  { "token-buffer-arena", PPLEX_DEFAULT, tokenise_all_in_arena<preprocessor_lexer>, false }
+};
+
+const int runs_per_mode = 3;
+
+//Number of times the significant tokens are selected when timing passes over the tokens
+const int passes_per_run = 20;
+
+/**
+ * Generates roughly the specified number of bytes of source dominated by literals: long
+ * ordinary string literals with escapes, and raw string literals holding multi-line
+ * embedded text such as shaders or JSON, with the occasional ) which doesn't end them.
+ */
+string generate_literal_source(size_t length)
+{
+  static const char *const words[] = { "vec4", "uniform", "\"type\": \"object\"", "color", "{ }", "gl_Position", "(x)", "[1, 2]" };
+
+  bench_random rng(11);
+  string source;
+  source.reserve(length + 4096);
+
+  while(source.length() < length)
+  {
+    source += "const char *shader = R\"glsl(";
+
+    for(int line = 0, num_lines = 20 + rng.next(200); line < num_lines; line++)
+    {
+      for(int word = 0, num_words = 4 + rng.next(8); word < num_words; word++)
+      {
+        source += words[rng.next(8)];
+        source += " ";
+      }
+
+      source += "\n";
+    }
+
+    source += ")glsl\";\n";
+    source += "const char *message = \"";
+
+    for(int word = 0, num_words = 10 + rng.next(40); word < num_words; word++)
+    {
+      source += words[rng.next(8)];
+      source += rng.next(8) == 0 ? "\\n" : " ";
+    }
+
+    source += "\";\n";
+  }
+
+  return source;
+}
+
+/**
+ * Times repeatedly selecting the significant tokens of the input, as passes after lexing
+ * do, from an array of whole tokens and from a token buffer. Only the token types are
+ * read, so the token buffer reads one byte per token rather than a whole token.
+ */
+void bench_passes(const string &input)
+{
+  preprocessor_lexer vector_lexer(input.data(), input.length());
+  vector<preprocessor_token> token_vector;
+  preprocessor_token batch[256];
+
+  while(size_t batch_size = vector_lexer.next_tokens(batch, 256))
+    token_vector.insert(token_vector.end(), batch, batch + batch_size);
+
+  preprocessor_lexer buffer_lexer(input.data(), input.length());
+  token_buffer tokens;
+
+  buffer_lexer.tokenise(tokens);
+
+  double vector_best = 1e30;
+  double buffer_best = 1e30;
+
+  for(int run = 0; run < runs_per_mode; run++)
+  {
+    bench_timer vector_timer;
+
+    for(int pass = 0; pass < passes_per_run; pass++)
+    {
+      vector<uint32_t> significant;
+      select_significant(token_vector, significant);
+    }
+
+    vector_best = min(vector_best, vector_timer.elapsed_seconds());
+
+    bench_timer buffer_timer;
+
+    for(int pass = 0; pass < passes_per_run; pass++)
+    {
+      arena_vector<uint32_t> significant;
+      tokens.select(~insignificant_tokens, significant);
+    }
+
+    buffer_best = min(buffer_best, buffer_timer.elapsed_seconds());
+  }
+
+  cout << "  " << passes_per_run << " passes selecting the significant tokens" << endl;
+  cout << "  " << left << setw(28) << "token-vector" << right
+       << setw(8) << setprecision(3) << vector_best << " s" << endl;
+  cout << "  " << left << setw(28) << "token-buffer" << right
+       << setw(8) << setprecision(3) << buffer_best << " s" << endl;
+}
+
+/**
+ * Times lexing of the specified input with each lexer configuration, reporting the best of
+ * several runs. Returns false if the configurations disagree on the number of tokens.
+ */
+bool bench_input(const char *name, const string &input)
+{
+  double megabytes = input.length() / (1024.0 * 1024.0);
+  cout << name << ": " << fixed << setprecision(1) << megabytes << " MB input" << endl;
+
+  size_t expected_tokens = 0;
+  bool ascii_input = is_ascii_source(input.data(), input.length());
+
+  for(const lexer_mode &mode : modes)
+  {
+    if(mode.ascii_only && !ascii_input)
+    {
+      cout << "  " << left << setw(28) << mode.name << right << " skipped, input is not ASCII" << endl;
+      continue;
+    }
+
+    double best = 1e30;
+    size_t num_tokens = 0;
+
+    for(int run = 0; run < runs_per_mode; run++)
+    {
+      bench_timer timer;
+      num_tokens = mode.lex(input, mode.flags);
+      best = min(best, timer.elapsed_seconds());
+    }
+
+    if(expected_tokens == 0)
+      expected_tokens = num_tokens;
+    else if(num_tokens != expected_tokens)
+    {
+      cerr << mode.name << ": produced " << num_tokens << " tokens, expected " << expected_tokens << endl;
+      return false;
+    }
+
+    cout << "  " << left << setw(28) << mode.name << right
+         << setw(8) << setprecision(3) << best << " s "
+         << setw(8) << setprecision(1) << megabytes / best << " MB/s "
+         << num_tokens << " tokens" << endl;
+  }
+
+  bench_passes(input);
+
+  return true;
+}
+
+/**
+ * Usage: lexer_bench [file]
+ *
+ * Times lexing of the specified file, or of generated ordinary and literal heavy source if
+ * none is given, with each lexer configuration.
+ */
+int main(int argc, char **argv)
+{
+  bool consistent;
+
+  if(argc > 1)
+  {
+    ifstream file(argv[1], ios::binary);
+    ostringstream oss;
+    oss << file.rdbuf();
+    consistent = bench_input(argv[1], oss.str());
+  }
+  else
+    consistent = bench_input("ordinary", generate_ordinary_source(16 * 1024 * 1024))
+                 && bench_input("literals", generate_literal_source(16 * 1024 * 1024));
+
+  return consistent ? EXIT_SUCCESS : EXIT_FAILURE;
+}
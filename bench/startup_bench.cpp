@@ -0,0 +1,104 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+using namespace std;
+
+#include <spawn.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench_util.h"
+
+extern char **environ;
+
+const int num_runs = 500;
+
+/**
+ * Runs the program once over the specified file, with its output discarded, returning
+ * the time from starting it to it exiting, or a negative time if it fails.
+ */
+double time_run(const char *program, const char *path)
+{
+  char *const argv[] = { const_cast<char*>(program), const_cast<char*>(path), nullptr };
+  posix_spawn_file_actions_t actions;
+
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+  bench_timer timer;
+  pid_t pid;
+  int spawn_result = posix_spawn(&pid, program, &actions, nullptr, argv, environ);
+
+  posix_spawn_file_actions_destroy(&actions);
+
+  if(spawn_result != 0)
+    return -1;
+
+  int status;
+
+  if(waitpid(pid, &status, 0) == -1
+     || !WIFEXITED(status)
+     || WEXITSTATUS(status) != EXIT_SUCCESS)
+    return -1;
+
+  return timer.elapsed_seconds();
+}
+
+/**
+ * Measures the time to start each program and run it over an empty file, which is
+ * dominated by process start up, including any static initialisation, since the posttoken
+ * driver only has the end of file token to produce. The posttoken-starter program built
+ * from posttoken.cpp ignores its input. Usage: startup_bench [program...], which times
+ * ./posttoken if no program is given.
+ */
+int main(int argc, char **argv)
+{
+  char path[] = "/tmp/startup_benchXXXXXX";
+  int fd = mkstemp(path);
+
+  if(fd == -1)
+  {
+    cerr << "Unable to create an empty file" << endl;
+    return EXIT_FAILURE;
+  }
+
+  close(fd);
+
+  const char *default_program = "./posttoken";
+  const char *const *programs = argc > 1 ? argv + 1 : &default_program;
+  int num_programs = argc > 1 ? argc - 1 : 1;
+
+  for(int i = 0; i < num_programs; i++)
+  {
+    const char *program = programs[i];
+    double total = 0;
+    double best = 1e9;
+
+    for(int run = 0; run < num_runs; run++)
+    {
+      double elapsed = time_run(program, path);
+
+      if(elapsed < 0)
+      {
+        cerr << "Unable to run " << program << endl;
+        unlink(path);
+        return EXIT_FAILURE;
+      }
+
+      total += elapsed;
+      best = min(best, elapsed);
+    }
+
+    cout << "startup: " << program << " on an empty file, " << num_runs << " runs" << endl;
+    cout << "  mean " << fixed << setprecision(1) << total / num_runs * 1e6 << " us"
+         << ", best " << best * 1e6 << " us" << endl;
+  }
+
+  unlink(path);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+using namespace std;
+
+#include "util/utf8.h"
+#include "bench_util.h"
+
+const int runs_per_routine = 5;
+
+/**
+ * Generates source where every other line is a comment written in CJK characters, as
+ * found in code commented in Chinese or Japanese.
+ */
+string generate_cjk_source(size_t length)
+{
+  string ordinary = generate_ordinary_source(length / 2);
+  string source;
+  source.reserve(length + 256);
+
+  bench_random rng(7);
+  size_t line_start = 0;
+
+  while(line_start < ordinary.length() && source.length() < length)
+  {
+    size_t line_end = ordinary.find('\n', line_start);
+
+    if(line_end == string::npos)
+      line_end = ordinary.length() - 1;
+
+    source.append(ordinary, line_start, line_end - line_start + 1);
+    source += "  // ";
+
+    //Characters from the CJK unified ideographs block
+    for(int i = 0; i < 20; i++)
+    {
+      utf8_code_units code_units = encode_utf8(0x4E00 + rng.next(0x5000));
+      source.append(code_units.data, code_units.length);
+    }
+
+    source += "\n";
+    line_start = line_end + 1;
+  }
+
+  return source;
+}
+
+/**
+ * Decodes the input one code point at a time, the way the lexer did before the bulk routines.
+ */
+size_t decode_per_code_point(const string &input, vector<char32_t> &out)
+{
+  const char *pos = input.data();
+  const char *end = pos + input.length();
+  size_t num_code_points = 0;
+
+  while(pos < end)
+  {
+    size_t length = utf8_sequence_length(*pos);
+
+    if(length == 0 || length > (size_t)(end - pos))
+      break;
+
+    out[num_code_points++] = decode_utf8(pos, length);
+    pos += length;
+  }
+
+  return num_code_points;
+}
+
+/**
+ * Times each of the routines over the specified input, reporting the best of several runs.
+ */
+void bench_input(const char *name, const string &input)
+{
+  double megabytes = input.length() / (1024.0 * 1024.0);
+  vector<char32_t> out(input.length());
+
+  cout << name << ": " << fixed << setprecision(1) << megabytes << " MB input" << endl;
+
+  for(int routine = 0; routine < 3; routine++)
+  {
+    static const char *const routine_names[] = { "per-code-point decode", "validate_utf8", "decode_utf8_to_utf32" };
+    double best = 1e30;
+    size_t result = 0;
+
+    for(int run = 0; run < runs_per_routine; run++)
+    {
+      bench_timer timer;
+
+      if(routine == 0)
+        result = decode_per_code_point(input, out);
+      else if(routine == 1)
+        result = validate_utf8(input.data(), input.length()) == utf8_no_error;
+      else
+        decode_utf8_to_utf32(input.data(), input.length(), out.data(), result);
+
+      best = min(best, timer.elapsed_seconds());
+    }
+
+    cout << "  " << left << setw(28) << routine_names[routine] << right
+         << setw(8) << setprecision(4) << best << " s "
+         << setw(8) << setprecision(1) << megabytes / best << " MB/s" << endl;
+  }
+}
+
+/**
+ * Usage: utf8_bench
+ *
+ * Times UTF-8 validation and decoding over ASCII and CJK heavy source.
+ */
+int main()
+{
+  bench_input("ascii", generate_ordinary_source(16 * 1024 * 1024));
+  bench_input("cjk", generate_cjk_source(16 * 1024 * 1024));
+}
@@ -0,0 +1,116 @@
+#ifndef CONCURRENT_IDENTIFIER_TABLE_H
+#define CONCURRENT_IDENTIFIER_TABLE_H
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+using std::atomic;
+using std::mutex;
+using std::unique_ptr;
+using std::vector;
+
+#include "preprocessor/preprocessor_lexer.h"
+
+//An identifier_table which any number of threads can intern identifiers in at once, so
+//lexers running in parallel share one set of symbols and the spellings of common names
+//are only stored once. Looking up an identifier which has already been interned never
+//takes a lock. The table is split into shards by hash, each an open addressed table of
+//atomic slots, and inserting a new identifier only locks its shard.
+class concurrent_identifier_table
+{
+private:
+
+  //An interned identifier. Never moves once published.
+  struct symbol
+  {
+    const char *spelling;
+    uint32_t length;
+    uint64_t hash;
+  };
+
+  //Symbols are stored by ID in fixed size chunks, which are allocated as needed and
+  //found through a directory covering every possible ID
+  static const unsigned int symbol_chunk_bits = 16;
+  static const size_t symbol_chunk_size = size_t(1) << symbol_chunk_bits;
+  static const size_t max_symbol_chunks = (size_t(1) << 32) / symbol_chunk_size;
+
+  unique_ptr<atomic<symbol*>[]> mSymbolChunks;
+  atomic<uint32_t> mNumSymbols;
+
+  //The slots of a shard. Each holds the top 32 bits of the identifier's hash above its
+  //symbol_id + 1, or is 0 if empty.
+  struct shard_slots
+  {
+    size_t mask;
+    unique_ptr<atomic<uint64_t>[]> slots;
+  };
+
+  //A shard's current slots are replaced by a table twice the size when it becomes half
+  //full. Lookups may still be reading the old slots so they are only freed along with
+  //the whole table. Each shard is padded out to its own cache lines.
+  struct shard
+  {
+    atomic<shard_slots*> slots;
+    mutex insert_mutex;
+    size_t num_symbols;
+    vector<unique_ptr<shard_slots>> all_slots;
+
+    //Blocks the spellings of the shard's identifiers are copied into, and how much of
+    //the block currently being filled is used
+    vector<unique_ptr<char[]>> spelling_blocks;
+    char *spelling_block;
+    size_t spelling_block_used;
+
+    char padding[64];
+  };
+
+  static const unsigned int num_shards = 64;
+  static const size_t spelling_block_size = 64 * 1024;
+
+  unique_ptr<shard[]> mShards;
+
+  const symbol &symbol_at(symbol_id sym) const
+  {
+    return mSymbolChunks[sym >> symbol_chunk_bits].load(std::memory_order_acquire)[sym & (symbol_chunk_size - 1)];
+  }
+
+  shard &shard_for(uint64_t hash) const
+  {
+    return mShards[(hash >> 26) & (num_shards - 1)];
+  }
+
+  symbol_id probe(const shard_slots *slots, const char *spelling, size_t length, uint64_t hash, size_t &empty_slot) const;
+  shard_slots *grow(shard &sh);
+  const char *store_spelling(shard &sh, const char *spelling, size_t length);
+  symbol *symbol_chunk(size_t chunk);
+
+public:
+
+  concurrent_identifier_table();
+  ~concurrent_identifier_table();
+
+  //Symbols refer into the table so it can't be copied
+  concurrent_identifier_table(const concurrent_identifier_table&) = delete;
+  concurrent_identifier_table &operator=(const concurrent_identifier_table&) = delete;
+
+  size_t size() const { return mNumSymbols.load(std::memory_order_relaxed); }
+
+  symbol_id intern(const char *spelling, size_t length);
+  symbol_id find(const char *spelling, size_t length) const;
+
+  /*
+   * Returns the spelling of a symbol, which remains valid for the lifetime of the table.
+   */
+  token_spelling spelling(symbol_id sym) const
+  {
+    const symbol &entry = symbol_at(sym);
+    return { entry.spelling, entry.length };
+  }
+};
+
+concurrent_identifier_table &shared_identifier_table();
+
+#endif //CONCURRENT_IDENTIFIER_TABLE_H
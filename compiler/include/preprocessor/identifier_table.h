@@ -0,0 +1,64 @@
+#ifndef IDENTIFIER_TABLE_H
+#define IDENTIFIER_TABLE_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+using std::vector;
+using std::string;
+
+#include "preprocessor/preprocessor_lexer.h"
+
+uint64_t hash_identifier(const char *spelling, size_t length);
+
+//Interns identifiers, mapping each distinct identifier to a dense symbol_id from 0 so
+//identifiers can be compared, and used to look up macros, as integers. Spellings are
+//interned as the lexer produces them, with universal-character-names and UTF-8 alike
+//decoded to UTF-8, so the different spellings of the same identifier share a symbol.
+class identifier_table
+{
+private:
+
+  //An interned identifier: its hash, and where its spelling is within mSpellings
+  struct symbol
+  {
+    uint64_t hash;
+    uint32_t offset;
+    uint32_t length;
+  };
+
+  vector<symbol> mSymbols;
+  string mSpellings;
+
+  //Open addressed hash table of symbols, each slot holding a symbol_id + 1 or 0 if empty.
+  //The number of slots is a power of 2 and at least twice the number of symbols.
+  vector<uint32_t> mSlots;
+
+  size_t find_slot(const char *spelling, size_t length, uint64_t hash) const;
+  void grow();
+
+public:
+
+  identifier_table(size_t expected_symbols = 1024);
+
+  //Symbols refer into the table so it can't be copied
+  identifier_table(const identifier_table&) = delete;
+  identifier_table &operator=(const identifier_table&) = delete;
+
+  size_t size() const { return mSymbols.size(); }
+
+  symbol_id intern(const char *spelling, size_t length);
+  symbol_id find(const char *spelling, size_t length) const;
+
+  /*
+   * Returns the spelling of a symbol, which remains valid until the next identifier is
+   * interned.
+   */
+  token_spelling spelling(symbol_id sym) const
+  {
+    return { mSpellings.data() + mSymbols[sym].offset, mSymbols[sym].length };
+  }
+};
+
+#endif //IDENTIFIER_TABLE_H
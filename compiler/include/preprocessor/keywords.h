@@ -0,0 +1,306 @@
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "preprocessor/punctuators.h"
+
+//The keywords. See C++ standard 2.12 Keywords.
+enum preprocessor_keyword : unsigned char
+{
+  KEYWORD_NONE = 0,
+  KEYWORD_ALIGNAS,
+  KEYWORD_ALIGNOF,
+  KEYWORD_ASM,
+  KEYWORD_AUTO,
+  KEYWORD_BOOL,
+  KEYWORD_BREAK,
+  KEYWORD_CASE,
+  KEYWORD_CATCH,
+  KEYWORD_CHAR,
+  KEYWORD_CHAR16_T,
+  KEYWORD_CHAR32_T,
+  KEYWORD_CLASS,
+  KEYWORD_CONST,
+  KEYWORD_CONSTEXPR,
+  KEYWORD_CONST_CAST,
+  KEYWORD_CONTINUE,
+  KEYWORD_DECLTYPE,
+  KEYWORD_DEFAULT,
+  KEYWORD_DELETE,
+  KEYWORD_DO,
+  KEYWORD_DOUBLE,
+  KEYWORD_DYNAMIC_CAST,
+  KEYWORD_ELSE,
+  KEYWORD_ENUM,
+  KEYWORD_EXPLICIT,
+  KEYWORD_EXPORT,
+  KEYWORD_EXTERN,
+  KEYWORD_FALSE,
+  KEYWORD_FLOAT,
+  KEYWORD_FOR,
+  KEYWORD_FRIEND,
+  KEYWORD_GOTO,
+  KEYWORD_IF,
+  KEYWORD_INLINE,
+  KEYWORD_INT,
+  KEYWORD_LONG,
+  KEYWORD_MUTABLE,
+  KEYWORD_NAMESPACE,
+  KEYWORD_NEW,
+  KEYWORD_NOEXCEPT,
+  KEYWORD_NULLPTR,
+  KEYWORD_OPERATOR,
+  KEYWORD_PRIVATE,
+  KEYWORD_PROTECTED,
+  KEYWORD_PUBLIC,
+  KEYWORD_REGISTER,
+  KEYWORD_REINTERPRET_CAST,
+  KEYWORD_RETURN,
+  KEYWORD_SHORT,
+  KEYWORD_SIGNED,
+  KEYWORD_SIZEOF,
+  KEYWORD_STATIC,
+  KEYWORD_STATIC_ASSERT,
+  KEYWORD_STATIC_CAST,
+  KEYWORD_STRUCT,
+  KEYWORD_SWITCH,
+  KEYWORD_TEMPLATE,
+  KEYWORD_THIS,
+  KEYWORD_THREAD_LOCAL,
+  KEYWORD_THROW,
+  KEYWORD_TRUE,
+  KEYWORD_TRY,
+  KEYWORD_TYPEDEF,
+  KEYWORD_TYPEID,
+  KEYWORD_TYPENAME,
+  KEYWORD_UNION,
+  KEYWORD_UNSIGNED,
+  KEYWORD_USING,
+  KEYWORD_VIRTUAL,
+  KEYWORD_VOID,
+  KEYWORD_VOLATILE,
+  KEYWORD_WCHAR_T,
+  KEYWORD_WHILE,
+  KEYWORD_NUM_KEYWORDS
+};
+
+//A word spelt like an identifier which has a meaning of its own: a keyword, an
+//identifier-like operator, or both in the case of new and delete
+struct identifier_word
+{
+  const char *spelling;
+  preprocessor_keyword keyword;
+  preprocessor_punctuator punctuator;
+};
+
+constexpr identifier_word identifier_words[] =
+{
+  {"alignas", KEYWORD_ALIGNAS, PUNC_NONE},
+  {"alignof", KEYWORD_ALIGNOF, PUNC_NONE},
+  {"asm", KEYWORD_ASM, PUNC_NONE},
+  {"auto", KEYWORD_AUTO, PUNC_NONE},
+  {"bool", KEYWORD_BOOL, PUNC_NONE},
+  {"break", KEYWORD_BREAK, PUNC_NONE},
+  {"case", KEYWORD_CASE, PUNC_NONE},
+  {"catch", KEYWORD_CATCH, PUNC_NONE},
+  {"char", KEYWORD_CHAR, PUNC_NONE},
+  {"char16_t", KEYWORD_CHAR16_T, PUNC_NONE},
+  {"char32_t", KEYWORD_CHAR32_T, PUNC_NONE},
+  {"class", KEYWORD_CLASS, PUNC_NONE},
+  {"const", KEYWORD_CONST, PUNC_NONE},
+  {"constexpr", KEYWORD_CONSTEXPR, PUNC_NONE},
+  {"const_cast", KEYWORD_CONST_CAST, PUNC_NONE},
+  {"continue", KEYWORD_CONTINUE, PUNC_NONE},
+  {"decltype", KEYWORD_DECLTYPE, PUNC_NONE},
+  {"default", KEYWORD_DEFAULT, PUNC_NONE},
+  {"delete", KEYWORD_DELETE, PUNC_DELETE},
+  {"do", KEYWORD_DO, PUNC_NONE},
+  {"double", KEYWORD_DOUBLE, PUNC_NONE},
+  {"dynamic_cast", KEYWORD_DYNAMIC_CAST, PUNC_NONE},
+  {"else", KEYWORD_ELSE, PUNC_NONE},
+  {"enum", KEYWORD_ENUM, PUNC_NONE},
+  {"explicit", KEYWORD_EXPLICIT, PUNC_NONE},
+  {"export", KEYWORD_EXPORT, PUNC_NONE},
+  {"extern", KEYWORD_EXTERN, PUNC_NONE},
+  {"false", KEYWORD_FALSE, PUNC_NONE},
+  {"float", KEYWORD_FLOAT, PUNC_NONE},
+  {"for", KEYWORD_FOR, PUNC_NONE},
+  {"friend", KEYWORD_FRIEND, PUNC_NONE},
+  {"goto", KEYWORD_GOTO, PUNC_NONE},
+  {"if", KEYWORD_IF, PUNC_NONE},
+  {"inline", KEYWORD_INLINE, PUNC_NONE},
+  {"int", KEYWORD_INT, PUNC_NONE},
+  {"long", KEYWORD_LONG, PUNC_NONE},
+  {"mutable", KEYWORD_MUTABLE, PUNC_NONE},
+  {"namespace", KEYWORD_NAMESPACE, PUNC_NONE},
+  {"new", KEYWORD_NEW, PUNC_NEW},
+  {"noexcept", KEYWORD_NOEXCEPT, PUNC_NONE},
+  {"nullptr", KEYWORD_NULLPTR, PUNC_NONE},
+  {"operator", KEYWORD_OPERATOR, PUNC_NONE},
+  {"private", KEYWORD_PRIVATE, PUNC_NONE},
+  {"protected", KEYWORD_PROTECTED, PUNC_NONE},
+  {"public", KEYWORD_PUBLIC, PUNC_NONE},
+  {"register", KEYWORD_REGISTER, PUNC_NONE},
+  {"reinterpret_cast", KEYWORD_REINTERPRET_CAST, PUNC_NONE},
+  {"return", KEYWORD_RETURN, PUNC_NONE},
+  {"short", KEYWORD_SHORT, PUNC_NONE},
+  {"signed", KEYWORD_SIGNED, PUNC_NONE},
+  {"sizeof", KEYWORD_SIZEOF, PUNC_NONE},
+  {"static", KEYWORD_STATIC, PUNC_NONE},
+  {"static_assert", KEYWORD_STATIC_ASSERT, PUNC_NONE},
+  {"static_cast", KEYWORD_STATIC_CAST, PUNC_NONE},
+  {"struct", KEYWORD_STRUCT, PUNC_NONE},
+  {"switch", KEYWORD_SWITCH, PUNC_NONE},
+  {"template", KEYWORD_TEMPLATE, PUNC_NONE},
+  {"this", KEYWORD_THIS, PUNC_NONE},
+  {"thread_local", KEYWORD_THREAD_LOCAL, PUNC_NONE},
+  {"throw", KEYWORD_THROW, PUNC_NONE},
+  {"true", KEYWORD_TRUE, PUNC_NONE},
+  {"try", KEYWORD_TRY, PUNC_NONE},
+  {"typedef", KEYWORD_TYPEDEF, PUNC_NONE},
+  {"typeid", KEYWORD_TYPEID, PUNC_NONE},
+  {"typename", KEYWORD_TYPENAME, PUNC_NONE},
+  {"union", KEYWORD_UNION, PUNC_NONE},
+  {"unsigned", KEYWORD_UNSIGNED, PUNC_NONE},
+  {"using", KEYWORD_USING, PUNC_NONE},
+  {"virtual", KEYWORD_VIRTUAL, PUNC_NONE},
+  {"void", KEYWORD_VOID, PUNC_NONE},
+  {"volatile", KEYWORD_VOLATILE, PUNC_NONE},
+  {"wchar_t", KEYWORD_WCHAR_T, PUNC_NONE},
+  {"while", KEYWORD_WHILE, PUNC_NONE},
+
+  // See C++ standard 2.13 Operators and punctuators
+  {"and", KEYWORD_NONE, PUNC_ALT_AND},
+  {"and_eq", KEYWORD_NONE, PUNC_ALT_AND_EQ},
+  {"bitand", KEYWORD_NONE, PUNC_ALT_BITAND},
+  {"bitor", KEYWORD_NONE, PUNC_ALT_BITOR},
+  {"compl", KEYWORD_NONE, PUNC_ALT_COMPL},
+  {"not", KEYWORD_NONE, PUNC_ALT_NOT},
+  {"not_eq", KEYWORD_NONE, PUNC_ALT_NOT_EQ},
+  {"or", KEYWORD_NONE, PUNC_ALT_OR},
+  {"or_eq", KEYWORD_NONE, PUNC_ALT_OR_EQ},
+  {"xor", KEYWORD_NONE, PUNC_ALT_XOR},
+  {"xor_eq", KEYWORD_NONE, PUNC_ALT_XOR_EQ}
+};
+
+const size_t num_identifier_words = sizeof(identifier_words) / sizeof(identifier_words[0]);
+
+//The shortest and longest words. Anything outside this range can't be a word so isn't
+//hashed.
+const size_t min_identifier_word_length = 2;
+const size_t max_identifier_word_length = 16;
+
+//Number of slots in the perfect hash table, as a power of 2
+const unsigned int identifier_word_hash_bits = 9;
+const size_t identifier_word_hash_size = size_t(1) << identifier_word_hash_bits;
+
+/*
+ * Hashes a word using only its length and its first two, middle and last two characters,
+ * so the cost doesn't depend on the length. The seed is chosen so that no two words
+ * collide.
+ */
+constexpr unsigned int identifier_word_hash(const char *word, size_t length, uint64_t seed)
+{
+  uint64_t key = (uint64_t)(unsigned char)word[0]
+                 | (uint64_t)(unsigned char)word[1] << 8
+                 | (uint64_t)(unsigned char)word[length - 2] << 16
+                 | (uint64_t)(unsigned char)word[length - 1] << 24
+                 | (uint64_t)(unsigned char)word[length / 2] << 32
+                 | (uint64_t)length << 40;
+
+  return (unsigned int)((key * seed) >> (64 - identifier_word_hash_bits));
+}
+
+constexpr size_t identifier_word_length(const char *word)
+{
+  size_t length = 0;
+
+  while(word[length])
+    length++;
+
+  return length;
+}
+
+/*
+ * Searches for a seed which hashes every word to a different slot. Returns 0 if none of
+ * the candidate seeds do.
+ */
+constexpr uint64_t find_identifier_word_seed()
+{
+  for(uint64_t candidate = 1; candidate <= 100000; candidate++)
+  {
+    uint64_t seed = (candidate * 0x9E3779B97F4A7C15ull) | 1;
+    bool used[identifier_word_hash_size] = {};
+    bool collision = false;
+
+    for(size_t i = 0; i < num_identifier_words && !collision; i++)
+    {
+      const char *spelling = identifier_words[i].spelling;
+      unsigned int slot = identifier_word_hash(spelling, identifier_word_length(spelling), seed);
+
+      collision = used[slot];
+      used[slot] = true;
+    }
+
+    if(!collision)
+      return seed;
+  }
+
+  return 0;
+}
+
+constexpr uint64_t identifier_word_seed = find_identifier_word_seed();
+static_assert(identifier_word_seed != 0, "No perfect hash seed found for the identifier words");
+
+//The perfect hash table, holding the index of the word in each slot plus 1, or 0 for an
+//empty slot, and the length of each word
+struct identifier_word_table
+{
+  unsigned char slots[identifier_word_hash_size];
+  unsigned char lengths[num_identifier_words];
+};
+
+constexpr identifier_word_table make_identifier_word_table()
+{
+  identifier_word_table table = {};
+
+  for(size_t i = 0; i < num_identifier_words; i++)
+  {
+    const char *spelling = identifier_words[i].spelling;
+    size_t length = identifier_word_length(spelling);
+
+    table.slots[identifier_word_hash(spelling, length, identifier_word_seed)] = i + 1;
+    table.lengths[i] = length;
+  }
+
+  return table;
+}
+
+constexpr identifier_word_table identifier_word_slots = make_identifier_word_table();
+
+/*
+ * Returns the keyword or identifier-like operator with the specified spelling, or null if
+ * it's an ordinary identifier. A single probe of the hash table finds the only candidate.
+ */
+inline const identifier_word *find_identifier_word(const char *identifier, size_t length)
+{
+  if(length < min_identifier_word_length
+     || length > max_identifier_word_length)
+    return nullptr;
+
+  unsigned int slot = identifier_word_slots.slots[identifier_word_hash(identifier, length, identifier_word_seed)];
+
+  if(!slot)
+    return nullptr;
+
+  if(identifier_word_slots.lengths[slot - 1] != length
+     || memcmp(identifier_words[slot - 1].spelling, identifier, length) != 0)
+    return nullptr;
+
+  return &identifier_words[slot - 1];
+}
+
+#endif //KEYWORDS_H
@@ -11,6 +11,7 @@ private:
 
 public:
   preprocessor_token next_token() { return mLexer.next_token(); }
+  token_spelling spelling(const preprocessor_token &tok) const { return mLexer.spelling(tok); }
   bool has_more_tokens() { return !mLexer.finished_tokenising(); }
 };
 
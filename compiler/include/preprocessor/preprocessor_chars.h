@@ -0,0 +1,110 @@
+#ifndef PREPROCESSOR_CHARS_H
+#define PREPROCESSOR_CHARS_H
+
+//Character classification helpers shared by the lexer and translation phases.
+
+//Classes of the first character of a preprocessing token, which select how it's lexed
+enum char_class
+{
+  CHCLASS_OTHER,              //Anything else, including characters outside the basic source character set
+  CHCLASS_WHITESPACE,
+  CHCLASS_NEW_LINE,
+  CHCLASS_IDENTIFIER,         //A nondigit which can't start a literal
+  CHCLASS_ENCODING_PREFIX,    //u, U or L which may start a character or string literal
+  CHCLASS_RAW_PREFIX,         //R which may start a raw string literal
+  CHCLASS_DIGIT,
+  CHCLASS_DOT,
+  CHCLASS_STRING,
+  CHCLASS_CHAR,
+  CHCLASS_BACKSLASH,
+  CHCLASS_PUNCTUATOR
+};
+
+//The class of each of the 256 byte values
+struct char_class_table
+{
+  unsigned char classes[256];
+};
+
+/*
+ * Builds the class table. Only the basic source character set is classified, every other
+ * value is CHCLASS_OTHER.
+ */
+constexpr char_class_table make_char_class_table()
+{
+  char_class_table table = {};
+
+  for(int ch = 'a'; ch <= 'z'; ch++)
+  {
+    table.classes[ch] = CHCLASS_IDENTIFIER;
+    table.classes[ch - 'a' + 'A'] = CHCLASS_IDENTIFIER;
+  }
+
+  table.classes['_'] = CHCLASS_IDENTIFIER;
+  table.classes['u'] = CHCLASS_ENCODING_PREFIX;
+  table.classes['U'] = CHCLASS_ENCODING_PREFIX;
+  table.classes['L'] = CHCLASS_ENCODING_PREFIX;
+  table.classes['R'] = CHCLASS_RAW_PREFIX;
+
+  for(int ch = '0'; ch <= '9'; ch++)
+    table.classes[ch] = CHCLASS_DIGIT;
+
+  for(const char *ch = " \t\v\f\r"; *ch; ch++)
+    table.classes[(unsigned char)*ch] = CHCLASS_WHITESPACE;
+
+  for(const char *ch = "#<>%:|&{}[]();?~,^/*+-!="; *ch; ch++)
+    table.classes[(unsigned char)*ch] = CHCLASS_PUNCTUATOR;
+
+  table.classes['\n'] = CHCLASS_NEW_LINE;
+  table.classes['.'] = CHCLASS_DOT;
+  table.classes['"'] = CHCLASS_STRING;
+  table.classes['\''] = CHCLASS_CHAR;
+  table.classes['\\'] = CHCLASS_BACKSLASH;
+
+  return table;
+}
+
+constexpr char_class_table char_classes = make_char_class_table();
+
+/*
+ * Returns the class of the specified character.
+ */
+inline char_class classify_char(int ch)
+{
+  return (unsigned int)ch < 256 ? (char_class)char_classes.classes[ch] : CHCLASS_OTHER;
+}
+
+//Stands in for a character which couldn't be decoded, when recovering from errors. It's
+//outside the range of Unicode so no classification accepts it, and is spelt as U+FFFD.
+const int invalid_code_point = 0x110000;
+const int replacement_character = 0xFFFD;
+
+//preprocessor_chars.cpp
+bool is_identifier_non_digit(int ch);
+bool valid_identifier_char(int ch);
+bool valid_initial_identifier_char(int ch);
+int hex_char_to_int_value(int c);
+int fold_trigraph(int ch);
+
+/*
+ * Determines whether the specified character is a nondigit from the basic source
+ * character set: a-z, A-Z or _
+ */
+inline bool is_basic_identifier_non_digit(int ch)
+{
+  return (ch >= 'a' && ch <= 'z')
+         || (ch >= 'A' && ch <= 'Z')
+         || ch == '_';
+}
+
+/*
+ * Determines whether the specified character is a nondigit or digit from the basic
+ * source character set.
+ */
+inline bool is_basic_identifier_char(int ch)
+{
+  return is_basic_identifier_non_digit(ch)
+         || (ch >= '0' && ch <= '9');
+}
+
+#endif //PREPROCESSOR_CHARS_H
@@ -0,0 +1,42 @@
+#ifndef PREPROCESSOR_DIAGNOSTIC_H
+#define PREPROCESSOR_DIAGNOSTIC_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+using std::string;
+using std::vector;
+
+//The errors which can be found in the input while lexing it
+enum preprocessor_diagnostic_code : unsigned char
+{
+  PPDIAG_INVALID_UTF8 = 0,
+  PPDIAG_TRUNCATED_UTF8,
+  PPDIAG_NEW_LINE_IN_HEADER_NAME,
+  PPDIAG_UNTERMINATED_HEADER_NAME,
+  PPDIAG_UNTERMINATED_STRING_LITERAL,
+  PPDIAG_UNTERMINATED_CHAR_LITERAL,
+  PPDIAG_UNTERMINATED_RAW_STRING_LITERAL,
+  PPDIAG_INVALID_RAW_STRING_DELIMITER,
+  PPDIAG_RAW_STRING_DELIMITER_TOO_LONG,
+  PPDIAG_UNTERMINATED_COMMENT
+};
+
+//An error found in the input by a lexer which is recovering from errors instead of
+//throwing them: which error it is, and the offset of the input it was found at. Cheap to
+//record, as the message is only produced when asked for.
+struct preprocessor_diagnostic
+{
+  size_t offset;
+  preprocessor_diagnostic_code code;
+
+  string message() const;
+};
+
+typedef vector<preprocessor_diagnostic> diagnostic_list;
+
+//preprocessor_diagnostic.cpp
+const char *diagnostic_text(preprocessor_diagnostic_code code);
+void report_diagnostic(diagnostic_list *diagnostics, preprocessor_diagnostic_code code, size_t offset);
+
+#endif //PREPROCESSOR_DIAGNOSTIC_H
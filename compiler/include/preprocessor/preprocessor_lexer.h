@@ -2,12 +2,28 @@
 #define PREPROCESSOR_LEXER_H
 
 #include <string>
-#include <deque>
+#include <istream>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstring>
 using std::string;
-using std::deque;
+using std::istream;
+using std::unique_ptr;
+using std::vector;
+
+#include "preprocessor/preprocessor_diagnostic.h"
+#include "util/structural_index.h"
+#include "util/byte_scan.h"
+#include "util/ring_buffer.h"
+#include "util/generator.h"
+#include "util/arena.h"
+#include "preprocessor/preprocessor_chars.h"
+#include "preprocessor/punctuators.h"
+#include "preprocessor/keywords.h"
 
 //Different types of preprocessing tokens
-enum preprocessor_token_type
+enum preprocessor_token_type : unsigned char
 {
   PPTOK_WHITESPACE = 0,
   PPTOK_NEW_LINE,
@@ -20,31 +36,160 @@ enum preprocessor_token_type
   PPTOK_USER_DEF_STRING_LITERAL,
   PPTOK_PREPROCESSING_OP_OR_PUNC,
   PPTOK_NON_WHITESPACE_CHAR,
-  PPTOK_EOF
+  PPTOK_EOF,
+
+  //Input containing an error, which was recovered from by lexing past it, see
+  //PPLEX_RECOVER_ERRORS
+  PPTOK_INVALID
+};
+
+//Optional behaviours of the lexer, combined as a bit mask
+enum preprocessor_lexer_flags
+{
+  PPLEX_DEFAULT = 0,
+
+  //Always run the full per-character transformations, even within blocks of the input
+  //which contain nothing to transform
+  PPLEX_NO_CLEAN_BLOCK_FAST_PATH = 1 << 1,
+
+  //Build a structural index of the whole input up front, and find the ends of identifier,
+  //whitespace, literal and comment runs by searching it instead of scanning the input
+  PPLEX_STRUCTURAL_INDEX = 1 << 2,
+
+  //Intern identifiers in the table shared by every lexer in the process, see
+  //shared_identifier_table
+  PPLEX_SHARED_IDENTIFIERS = 1 << 3,
+
+  //Recover from errors in the input instead of throwing them. Each error is recorded as a
+  //diagnostic, see basic_preprocessor_lexer::diagnostics, and the token it was found in
+  //becomes a PPTOK_INVALID token holding the input lexed up to the point of the error.
+  //Lexing then carries on from there. Undecodable bytes are diagnosed and spelt as U+FFFD,
+  //and are invalid tokens on their own.
+  PPLEX_RECOVER_ERRORS = 1 << 4
 };
 
-//A single preprocessing token containing its data and its type.
+//Flags describing a preprocessor_token
+enum preprocessor_token_flags
+{
+  //The spelling is held in the lexer's spelling arena rather than being a span of the
+  //input. Set when a trigraph, line splice or universal-character-name was transformed
+  //within the token, and for every spelt token when streaming.
+  PPTOKFLAG_SPELLING_IN_ARENA = 1 << 0
+};
+
+//Dense ID of an interned identifier, see identifier_table
+typedef uint32_t symbol_id;
+
+//Symbol of the tokens which aren't interned identifiers
+const symbol_id no_symbol = UINT32_MAX;
+
+//A single preprocessing token. The token doesn't hold its spelling, only where to find
+//it: see basic_preprocessor_lexer::spelling. Punctuators are identified by punctuator
+//alone and whitespace, new-line and EOF tokens have no spelling.
 struct preprocessor_token
 {
-  preprocessor_token(preprocessor_token_type tok_type) : type(tok_type) {}
-  preprocessor_token(const string &tok_data, preprocessor_token_type tok_type) : data(tok_data), type(tok_type) { }
-  
-  //Contents of the token
-  string data;
+  preprocessor_token(preprocessor_token_type tok_type = PPTOK_EOF)
+    : type(tok_type), flags(0), punctuator(PUNC_NONE), keyword(KEYWORD_NONE), offset(0), length(0), symbol(no_symbol) {}
+
+  preprocessor_token(preprocessor_punctuator punc)
+    : type(PPTOK_PREPROCESSING_OP_OR_PUNC), flags(0), punctuator(punc), keyword(KEYWORD_NONE), offset(0), length(0), symbol(no_symbol) {}
 
   //Type of the token
   preprocessor_token_type type;
+
+  //Combination of preprocessor_token_flags
+  uint8_t flags;
+
+  //Which punctuator the token is, or PUNC_NONE
+  preprocessor_punctuator punctuator;
+
+  //Which keyword an identifier (or the new and delete operators) is, or KEYWORD_NONE
+  preprocessor_keyword keyword;
+
+  //Offset and length of the spelling within the input or the spelling arena
+  uint32_t offset;
+  uint32_t length;
+
+  //The interned identifier, when the lexer has an identifier table, or no_symbol
+  symbol_id symbol;
 };
 
-//Lexer which tokenises input source code into a series of preprocessor tokens.
-class preprocessor_lexer
+//The spelling of a token, which remains owned by the lexer
+struct token_spelling
+{
+  const char *data;
+  size_t length;
+
+  string str() const { return string(data, length); }
+
+  bool operator==(const char *other) const
+  {
+    return strlen(other) == length
+           && memcmp(data, other, length) == 0;
+  }
+
+  bool operator!=(const char *other) const { return !(*this == other); }
+};
+
+class token_buffer;
+class identifier_table;
+class concurrent_identifier_table;
+
+//Input traits for source which may contain any UTF-8 encoded characters, trigraphs and
+//universal-character-names. This is the general case.
+struct utf8_input_traits
+{
+  static const bool ascii_only = false;
+};
+
+//Input traits for source known to consist of only 7-bit ASCII characters with no
+//trigraphs or universal-character-names, so no character can ever be outside the basic
+//source character set. The UTF-8 and extended identifier character handling is compiled
+//out of the lexer.
+struct ascii_input_traits
+{
+  static const bool ascii_only = true;
+};
+
+//Lexer which tokenises input source code into a series of preprocessor tokens. Lexing
+//takes time linear in the length of the input and constant stack, whatever the input:
+//lookahead is bounded, the lexer only ever rewinds a bounded distance and restores the
+//characters it had queued when it does, and runs of line splices and pp-number character
+//groups are consumed by loops rather than recursion. bench/adversarial_bench checks this.
+template<typename InputTraits>
+class basic_preprocessor_lexer
 {
 private:
 
-  //The current input buffer, the end of the input buffer and the current position within the buffer
+  //Owned copy of the input when constructed from a string, or the refillable window
+  //over the input when streaming. Empty when lexing directly from a caller supplied buffer.
   string mBuffer;
-  string::const_iterator mBufferEnd;
-  string::const_iterator mCurrPosition;
+
+  //The start of the input buffer, the end of the input buffer and the current position
+  //within the buffer
+  const char *mBufferStart;
+  const char *mBufferEnd;
+  const char *mCurrPosition;
+
+  //When streaming, the stream the window is refilled from, the number of bytes to read
+  //per refill and the offset of the start of the window from the start of the input.
+  //mStream is null when not streaming or once the end of the stream has been reached.
+  istream *mStream;
+  size_t mStreamChunkSize;
+  size_t mWindowOffset;
+
+  //Whether the input contains at least one character
+  bool mHaveInput;
+
+  //One bit per 64 byte block of the input (or streaming window), set if the block
+  //contains no bytes which could start a phase 1 or 2 transformation. Characters within
+  //clean blocks are read directly without applying the transformations.
+  vector<uint64_t> mCleanBlocks;
+  bool mUseCleanBlocks;
+
+  //Bitmasks of the interesting bytes of the whole input, when the structural index engine
+  //is in use. Replaces the clean blocks.
+  unique_ptr<structural_index> mStructuralIndex;
 
   //Last character that was processed.
   int mLastChar;
@@ -52,24 +197,61 @@ private:
   //Whether to suppress the standard transformations to apply when lexing each char
   int mSuppressTransformations;
 
+  //Whether the contents of a string or character literal are being lexed, within which
+  //comments aren't recognised
+  bool mInLiteral;
+
   //Buffer containing any characters produced as a result of UCN/trigraph
-  //transformations etc..
-  deque<int> mTransformedChars;
+  //transformations etc.., and the offset of the input they were produced from. A single
+  //transformation never produces more than a couple of characters.
+  ring_buffer<int, 8> mTransformedChars;
+  size_t mTransformedOffset;
 
-  //In some cases, calling next_token may result in one or more tokens actually being
-  //produced to resolve the ambiguity about what token the current position is referring
-  //to. This queue stores any pre-lexed tokens which should be returned on the next call
-  //to next_token
-  deque<preprocessor_token> mBufferedTokens;
+  //In some cases, scanning may result in more than one token actually being produced to
+  //resolve the ambiguity about what token the current position is referring to. This
+  //queue stores any pre-lexed tokens which should be returned on the next call to
+  //next_tokens. Input is only scanned once the queue is empty, and a single scan produces
+  //at most four tokens (# include, whitespace and a header-name).
+  ring_buffer<preprocessor_token, 8> mBufferedTokens;
 
-  //Saved current position/transformed chars to allow the current position
-  //to be rewound at a later point.
-  string::const_iterator mSavedCurrPosition;
-  deque<int> mSavedTransformedChars;
+  //While push_tokens is running, the sink tokens are passed to as soon as they are
+  //finished instead of being queued, and the function which passes them to it
+  void *mTokenSink;
+  void (*mTokenHandler)(void *sink, basic_preprocessor_lexer &lexer, const preprocessor_token &tok);
+
+  //A position the lexer can be rewound to: the offset from the start of the input of the
+  //character which was current when it was saved.
+  //Any transformed characters pending at that point are produced again after a rewind.
+  struct checkpoint
+  {
+    size_t offset;
+    bool saved;
+  };
+
+  checkpoint mCheckpoint;
 
   //If true, any synthesised EOF/new line tokens have already been added 
   bool mEndOfFileTokensProcessed;
 
+  //The spelling of the token being lexed, and the offset of the input it starts at. Kept
+  //between tokens so that its capacity is reused.
+  string mSpelling;
+  size_t mTokenStart;
+
+  //Spellings of the tokens which can't refer to the input directly
+  arena_string mSpellingArena;
+
+  //Table identifiers are interned in, if any, which may be shared with lexers on other
+  //threads. Not owned by the lexer.
+  identifier_table *mIdentifierTable;
+  concurrent_identifier_table *mConcurrentIdentifierTable;
+
+  //When recovering from errors, the errors found so far, and whether one has been found
+  //in the token being lexed
+  bool mRecoverErrors;
+  diagnostic_list mDiagnostics;
+  bool mTokenInvalid;
+
   //Methods to handle lexing of particular tokens
   bool lex_user_defined_string_literal_suffix(string &lit);
   void lex_encoding_prefix(string &prefix);
@@ -78,6 +260,7 @@ private:
   preprocessor_token lex_char_literal(bool wide_literal);
   preprocessor_token lex_identifier();
   void lex_pp_number(string &num);
+  void lex_punctuator(int curr_ch, bool header_name_allowed);
 
   //Methods to attempt lexing of a particular token type.
   bool maybe_lex_header_name();
@@ -86,16 +269,43 @@ private:
 
   //Miscalleneous helper methods
   bool start_of_encoding_prefix();
-  bool match_raw_string_delimiter(const string &delimiter);
+  preprocessor_token end_token(preprocessor_token_type type);
+
+  //Methods to pass tokens to the sink given to push_tokens
+  template<typename Sink>
+  void pass_token(Sink &sink, const preprocessor_token &tok);
+
+  template<typename Sink>
+  static void handle_token(void *sink, basic_preprocessor_lexer &lexer, const preprocessor_token &tok)
+  {
+    lexer.pass_token(*static_cast<Sink*>(sink), tok);
+  }
+
+  /*
+   * Produces a finished token, passing it straight to the sink while push_tokens is
+   * running and queueing it to be returned otherwise.
+   */
+  void emit_token(const preprocessor_token &tok)
+  {
+    if(mTokenHandler)
+      mTokenHandler(mTokenSink, *this, tok);
+    else
+      mBufferedTokens.push_back(tok);
+  }
 
   //Helper methods to append a character to a current token
   void append_chars_to_token_and_advance(string &tok, int count);
   void append_curr_char_to_token_and_advance(string &tok);
   void append_char_to_token(int ch, string &tok);
 
+  //Helper methods to append runs of a literal's contents which need no transformation
+  void append_literal_run(string &literal, char quote);
+  void append_raw_string_body(string &literal, const string &terminator);
+
   //Methods to skip over various parts of the input
+  int start_comment();
   void skip_cpp_comment();
-  void skip_c_comment();
+  void skip_c_comment(size_t comment_start);
   void skip_whitespace();
   void skip_chars(unsigned int count);
 
@@ -103,6 +313,8 @@ private:
   int next_char();
   int curr_char();
   int nth_char(unsigned int pos);
+  int peek_code_point();
+  const char *lookahead_position(unsigned int pos);
   
   //Method to apply the required transformations for a particular input character.
   int apply_transformations(int ch);
@@ -111,6 +323,262 @@ private:
   
   //Scans the next token or sequence of tokens.
   void scan_next_token();
+  size_t fill_tokens(preprocessor_token *tokens, size_t max_tokens);
+
+  //Number of tokens tokenise lexes at a time, and the number of input bytes it allows for
+  //each token when making room for them up front. Ordinary source averages a little over 3.
+  static const size_t token_batch_size = 256;
+  static const size_t bytes_per_token_estimate = 3;
+
+  /*
+   * Identifier character classification. Characters outside the basic source character
+   * set can't occur in ASCII only input so the Annex E ranges are never checked.
+   */
+  static bool identifier_non_digit(int ch)
+  {
+    return InputTraits::ascii_only ? is_basic_identifier_non_digit(ch) : is_identifier_non_digit(ch);
+  }
+
+  static bool identifier_char(int ch)
+  {
+    return InputTraits::ascii_only ? is_basic_identifier_char(ch) : valid_identifier_char(ch);
+  }
+
+  static bool initial_identifier_char(int ch)
+  {
+    return InputTraits::ascii_only || valid_initial_identifier_char(ch);
+  }
+
+  //Refills the streaming window from the input stream.
+  void refill_window();
+
+  //Sets up the lexer for the specified optional behaviours
+  void apply_flags(unsigned int flags);
+  void apply_stream_flags(unsigned int flags);
+
+  /*
+   * Reports an error found at the specified offset of the input. Throws it unless errors
+   * are being recovered from, in which case it is recorded and the caller recovers.
+   */
+  void report_error(preprocessor_diagnostic_code code, size_t offset)
+  {
+    report_diagnostic(mRecoverErrors ? &mDiagnostics : nullptr, code, offset);
+  }
+
+  /*
+   * Reports an error in the token being lexed, which becomes a PPTOK_INVALID token once
+   * the caller has recovered from it.
+   */
+  void invalidate_token(preprocessor_diagnostic_code code)
+  {
+    report_error(code, mTokenStart);
+    mTokenInvalid = true;
+  }
+
+  /*
+   * When streaming, makes sure enough input is available ahead of the current position
+   * for any lookahead.
+   */
+  void ensure_lookahead()
+  {
+    if(mStream
+       && (size_t)(mBufferEnd - mCurrPosition) < stream_lookahead)
+      refill_window();
+  }
+
+  /*
+   * Returns the offset of the current position from the start of the input. Unlike a
+   * pointer, this remains valid when the streaming window is refilled.
+   */
+  size_t position_offset()
+  {
+    return mWindowOffset + (mCurrPosition - mBufferStart);
+  }
+
+  /*
+   * Moves the current position to an offset previously returned by position_offset.
+   */
+  void set_position_offset(size_t offset)
+  {
+    mCurrPosition = mBufferStart + (offset - mWindowOffset);
+  }
+
+  /*
+   * Returns the raw input character at the specified position, or 0 at the end of the
+   * input. The buffer is not necessarily null terminated so it must never be read past
+   * its end.
+   */
+  int raw_char(const char *pos)
+  {
+    return pos < mBufferEnd ? *pos : '\0';
+  }
+
+  /*
+   * Returns the length of the run of basic identifier characters starting at the specified
+   * position, from the structural index if there is one or by scanning the input otherwise.
+   */
+  size_t identifier_run(const char *pos)
+  {
+    if(mStructuralIndex)
+      return mStructuralIndex->next_not(SI_IDENTIFIER, pos - mBufferStart) - (pos - mBufferStart);
+
+    return identifier_run_length(pos, mBufferEnd - pos);
+  }
+
+  /*
+   * Returns the length of the run of horizontal whitespace starting at the specified position.
+   */
+  size_t whitespace_run(const char *pos)
+  {
+    if(mStructuralIndex)
+      return mStructuralIndex->next_not(SI_WHITESPACE, pos - mBufferStart) - (pos - mBufferStart);
+
+    return whitespace_run_length(pos, mBufferEnd - pos);
+  }
+
+  /*
+   * Returns the length of the run of literal contents which can be copied directly, starting
+   * at the specified position, within a literal closed by the specified quote.
+   */
+  size_t literal_run(const char *pos, char quote)
+  {
+    if(mStructuralIndex)
+      return mStructuralIndex->next_of(SI_TRIGGER, quote == '"' ? SI_DOUBLE_QUOTE : SI_SINGLE_QUOTE,
+                                       pos - mBufferStart) - (pos - mBufferStart);
+
+    return literal_run_length(pos, mBufferEnd - pos, quote);
+  }
+
+  /*
+   * Finds the next occurrence of a byte, which the structural index records as the specified
+   * kind, at or after the specified position. Returns null if there isn't one.
+   */
+  const char *find_byte(const char *pos, char byte, structural_kind kind)
+  {
+    if(mStructuralIndex)
+    {
+      size_t offset = mStructuralIndex->next(kind, pos - mBufferStart);
+      return mBufferStart + offset < mBufferEnd ? mBufferStart + offset : nullptr;
+    }
+
+    return static_cast<const char*>(memchr(pos, byte, mBufferEnd - pos));
+  }
+
+  /*
+   * Determines whether the character at the specified position is known not to start a
+   * phase 1 or 2 transformation, so can be read directly.
+   */
+  bool untransformed_char(const char *pos)
+  {
+    if(mStructuralIndex)
+      return !mStructuralIndex->is(SI_TRIGGER, pos - mBufferStart);
+
+    return mUseCleanBlocks
+           && in_clean_block(mCleanBlocks, pos - mBufferStart);
+  }
+
+  /*
+   * Returns the length of the line splice, a \\ or ??/ followed by a new-line, which starts
+   * at the specified position, or 0 if there isn't one there.
+   */
+  size_t line_splice_length(const char *pos)
+  {
+    if(raw_char(pos) == '\\'
+       && raw_char(pos + 1) == '\n')
+      return 2;
+
+    if(!InputTraits::ascii_only
+       && raw_char(pos) == '?'
+       && raw_char(pos + 1) == '?'
+       && raw_char(pos + 2) == '/'
+       && raw_char(pos + 3) == '\n')
+      return 4;
+
+    return 0;
+  }
+
+  /*
+   * Determines whether the new-line at the specified position is the end of a line splice.
+   */
+  bool ends_line_splice(const char *new_line)
+  {
+    size_t preceding = new_line - mBufferStart;
+
+    if(preceding >= 1
+       && new_line[-1] == '\\')
+      return true;
+
+    return !InputTraits::ascii_only
+           && preceding >= 3
+           && new_line[-3] == '?'
+           && new_line[-2] == '?'
+           && new_line[-1] == '/';
+  }
+
+  /*
+   * Returns the distance from the current position of the first character at or after the
+   * specified distance which doesn't start a line splice. When streaming, the window is
+   * refilled as the splices are looked past, so a run of any length can be skipped.
+   */
+  size_t skip_lookahead_splices(size_t ahead)
+  {
+    while(true)
+    {
+      if(mStream
+         && (size_t)(mBufferEnd - mCurrPosition) < ahead + stream_lookahead)
+        refill_window();
+
+      size_t splice_length = line_splice_length(mCurrPosition + ahead);
+
+      if(!splice_length)
+        return ahead;
+
+      ahead += splice_length;
+    }
+  }
+
+  /*
+   * Advances the current position past any line splices starting at it.
+   */
+  void skip_line_splices()
+  {
+    ensure_lookahead();
+
+    while(size_t splice_length = line_splice_length(mCurrPosition))
+    {
+      mCurrPosition += splice_length;
+      ensure_lookahead();
+    }
+  }
+
+  /**
+   * Sets the buffer to lex and resets the lexer state.
+   */
+  void reset_input(const char *input, size_t length)
+  {
+    mBufferStart = input;
+    mBufferEnd = input + length;
+    mCurrPosition = input;
+    mCheckpoint.saved = false;
+    mTransformedChars.clear();
+    mTransformedOffset = 0;
+    mStream = nullptr;
+    mStreamChunkSize = 0;
+    mWindowOffset = 0;
+    mHaveInput = length > 0;
+    mUseCleanBlocks = false;
+    mSuppressTransformations = 0;
+    mInLiteral = false;
+    mLastChar = -1;
+    mEndOfFileTokensProcessed = false;
+    mTokenStart = 0;
+    mIdentifierTable = nullptr;
+    mConcurrentIdentifierTable = nullptr;
+    mRecoverErrors = false;
+    mTokenInvalid = false;
+    mTokenSink = nullptr;
+    mTokenHandler = nullptr;
+  }
 
   /*
    * Returns the next character in the stream without advancing the current position.
@@ -120,14 +588,41 @@ private:
     return nth_char(1);
   }
   
+  /*
+   * Indicates whether the input is being read incrementally from a stream.
+   */
+  bool streaming() const
+  {
+    return mStreamChunkSize != 0;
+  }
+
+  /*
+   * Returns the offset of the raw input the current character starts at, which is before
+   * the current position if the character is the result of a transformation.
+   */
+  size_t char_offset()
+  {
+    return mTransformedChars.empty() ? position_offset() : mTransformedOffset;
+  }
+
+  /*
+   * Starts a token with a spelling at the current character.
+   */
+  void begin_token()
+  {
+    mSpelling.clear();
+    mTokenStart = char_offset();
+  }
+
   /**
    * Saves the current position in the input buffer to allow it to
    * be rewound at a later point.
    */
   void save_current_position()
   {
-    mSavedCurrPosition = mCurrPosition;
-    mTransformedChars = mTransformedChars;
+    mCheckpoint.offset = char_offset();
+
+    mCheckpoint.saved = true;
   }
 
   /**
@@ -135,8 +630,10 @@ private:
    */
   void restore_saved_position()
   {
-    mCurrPosition = mSavedCurrPosition;
-    mTransformedChars = mSavedTransformedChars;
+    set_position_offset(mCheckpoint.offset);
+    mTransformedChars.clear();
+
+    mCheckpoint.saved = false;
   }
 
   /**
@@ -144,8 +641,7 @@ private:
    */
   void discard_saved_position()
   {
-    mSavedCurrPosition = mBuffer.end();
-    mSavedTransformedChars.clear();
+    mCheckpoint.saved = false;
   }
 
   /*
@@ -159,24 +655,277 @@ private:
 
 public:
 
+  //When streaming, the number of bytes which are always kept available before and after
+  //the current position. Covers the longest lookahead (a raw string delimiter) and the
+  //longest rewind (an invalid UCN). Looking past line splices refills the window itself.
+  static const size_t stream_lookahead = 64;
+
+  //Default number of bytes read from the stream at a time
+  static const size_t default_stream_chunk_size = 64 * 1024;
+
   int curr_tok_count() { return mBufferedTokens.size(); }
 
   /**
-   * Constructor. Allows the input string and output interface implementation
-   * to be passed in.
+   * Constructor. Takes a copy of the input string to lex.
    */
-  preprocessor_lexer(const string &input)
+  basic_preprocessor_lexer(const string &input, unsigned int flags = PPLEX_DEFAULT) : mBuffer(input)
   {
-    mBuffer = input;
-    mBufferEnd = mBuffer.cend();
-    mCurrPosition = mBuffer.cbegin();
-    mSuppressTransformations = 0;
-    mLastChar = -1;
-    mEndOfFileTokensProcessed = false;
+    reset_input(mBuffer.data(), mBuffer.length());
+    apply_flags(flags);
+  }
+
+  /**
+   * Constructor. Lexes directly from the specified buffer without copying it, so
+   * the buffer must outlive the lexer.
+   */
+  basic_preprocessor_lexer(const char *input, size_t length, unsigned int flags = PPLEX_DEFAULT)
+  {
+    reset_input(input, length);
+    apply_flags(flags);
+  }
+
+  /**
+   * Constructor. Lexes the input stream incrementally, reading it in chunks into a
+   * window which only holds the bytes still needed by the lexer, so memory use is bounded
+   * regardless of the length of the input, other than by a run of line splices the lexer
+   * has to look past. PPLEX_STRUCTURAL_INDEX needs the whole input up front, so can't be
+   * used when streaming.
+   */
+  basic_preprocessor_lexer(istream &input, size_t chunk_size = default_stream_chunk_size,
+                           unsigned int flags = PPLEX_DEFAULT)
+  {
+    reset_input(nullptr, 0);
+    apply_stream_flags(flags);
+    mStream = &input;
+    mStreamChunkSize = chunk_size < stream_lookahead ? stream_lookahead : chunk_size;
+    refill_window();
   }
 
+  //The lexer may point into its own buffer so can't be copied
+  basic_preprocessor_lexer(const basic_preprocessor_lexer&) = delete;
+  basic_preprocessor_lexer &operator=(const basic_preprocessor_lexer&) = delete;
+
   preprocessor_token next_token();
+  size_t next_tokens(preprocessor_token *tokens, size_t max_tokens);
   bool finished_tokenising();
+  void tokenise(token_buffer &tokens);
+
+  /*
+   * Interns every identifier lexed from now on in the specified table, which must
+   * outlive the lexer, setting the symbol of their tokens. The same table can be used by
+   * any number of lexers in turn so that symbols are comparable across inputs.
+   */
+  void intern_identifiers(identifier_table &table)
+  {
+    mIdentifierTable = &table;
+    mConcurrentIdentifierTable = nullptr;
+  }
+
+  void intern_identifiers(concurrent_identifier_table &table)
+  {
+    mIdentifierTable = nullptr;
+    mConcurrentIdentifierTable = &table;
+  }
+
+  /*
+   * Allocates the spellings of the tokens from the specified arena, normally the one for
+   * the translation unit being lexed, instead of the heap. Must be called before any
+   * tokens are lexed.
+   */
+  void use_arena(arena &memory)
+  {
+    mSpellingArena = arena_string(arena_allocator<char>(&memory));
+  }
+
+  /*
+   * Returns the errors found in the input so far, in the order they were found, when
+   * recovering from errors. Always empty otherwise.
+   */
+  const diagnostic_list &diagnostics() const
+  {
+    return mDiagnostics;
+  }
+
+  template<typename Sink>
+  void push_tokens(Sink &sink);
+
+#ifdef __cpp_impl_coroutine
+  generator<preprocessor_token> generate_tokens();
+#endif
+
+  /*
+   * Returns the spelling of a token produced by this lexer. The spelling remains valid
+   * for the lifetime of the lexer and its input, except when streaming, when it is only
+   * valid until the next call to next_token or next_tokens.
+   */
+  token_spelling spelling(const preprocessor_token &tok) const
+  {
+    if(tok.punctuator != PUNC_NONE)
+      return { punctuator_spellings[tok.punctuator], strlen(punctuator_spellings[tok.punctuator]) };
+
+    if(tok.flags & PPTOKFLAG_SPELLING_IN_ARENA)
+      return { mSpellingArena.data() + tok.offset, tok.length };
+
+    return { mBufferStart + tok.offset, tok.length };
+  }
 };
 
+/**
+ * Passes a single token to the sink given to push_tokens.
+ */
+template<typename InputTraits>
+template<typename Sink>
+void basic_preprocessor_lexer<InputTraits>::pass_token(Sink &sink, const preprocessor_token &tok)
+{
+  switch(tok.type)
+  {
+    case PPTOK_WHITESPACE:
+      sink.on_whitespace();
+      break;
+
+    case PPTOK_NEW_LINE:
+      sink.on_new_line();
+      break;
+
+    case PPTOK_HEADER_NAME:
+      sink.on_header_name(spelling(tok));
+      break;
+
+    case PPTOK_IDENTIFIER:
+      sink.on_identifier(spelling(tok), tok.keyword, tok.symbol);
+      break;
+
+    case PPTOK_NUMBER:
+      sink.on_number(spelling(tok));
+      break;
+
+    case PPTOK_CHAR_LITERAL:
+    case PPTOK_USER_DEF_CHAR_LITERAL:
+    case PPTOK_STRING_LITERAL:
+    case PPTOK_USER_DEF_STRING_LITERAL:
+      sink.on_literal(tok.type, spelling(tok));
+      break;
+
+    case PPTOK_PREPROCESSING_OP_OR_PUNC:
+      sink.on_punctuator(tok.punctuator);
+      break;
+
+    case PPTOK_NON_WHITESPACE_CHAR:
+      sink.on_non_whitespace_char(spelling(tok));
+      break;
+
+    case PPTOK_EOF:
+      sink.on_eof();
+      break;
+
+    case PPTOK_INVALID:
+      sink.on_invalid(spelling(tok));
+      break;
+  }
+}
+
+/**
+ * Tokenises the whole of the remaining input, passing each token to the specified sink
+ * from the scanning loop as soon as the token is finished, rather than queueing it to be
+ * returned. The sink is a template parameter, so its handlers are inlined into the single
+ * function the scanner calls for each token. It must provide:
+ *
+ *   void on_whitespace();
+ *   void on_new_line();
+ *   void on_header_name(token_spelling spelling);
+ *   void on_identifier(token_spelling spelling, preprocessor_keyword keyword, symbol_id symbol);
+ *   void on_number(token_spelling spelling);
+ *   void on_literal(preprocessor_token_type type, token_spelling spelling);
+ *   void on_punctuator(preprocessor_punctuator punc);
+ *   void on_non_whitespace_char(token_spelling spelling);
+ *   void on_eof();
+ *   void on_invalid(token_spelling spelling);
+ *
+ * on_literal receives the character and string literals, user-defined or not, which are
+ * told apart by type. Spellings are only valid for the duration of the call when
+ * streaming.
+ */
+template<typename InputTraits>
+template<typename Sink>
+void basic_preprocessor_lexer<InputTraits>::push_tokens(Sink &sink)
+{
+  //Tokens already queued by a pull before this call are passed on first
+  for(; !mBufferedTokens.empty(); mBufferedTokens.pop_front())
+    pass_token(sink, mBufferedTokens.front());
+
+  mTokenSink = &sink;
+  mTokenHandler = &handle_token<Sink>;
+
+  try
+  {
+    while(!mEndOfFileTokensProcessed)
+    {
+      if(streaming())
+        mSpellingArena.clear();
+
+      scan_next_token();
+    }
+  }
+  catch(...)
+  {
+    mTokenSink = nullptr;
+    mTokenHandler = nullptr;
+    throw;
+  }
+
+  mTokenSink = nullptr;
+  mTokenHandler = nullptr;
+}
+
+#ifdef __cpp_impl_coroutine
+
+/**
+ * Returns a generator which lazily lexes the whole of the remaining input, suspending
+ * at each token boundary. Each token is yielded straight from the queue scanning fills,
+ * so is only valid, along with its spelling when streaming, until the next one is pulled.
+ */
+template<typename InputTraits>
+generator<preprocessor_token> basic_preprocessor_lexer<InputTraits>::generate_tokens()
+{
+  while(!mEndOfFileTokensProcessed
+        || !mBufferedTokens.empty())
+  {
+    if(mBufferedTokens.empty())
+    {
+      if(streaming())
+        mSpellingArena.clear();
+
+      scan_next_token();
+    }
+
+    for(; !mBufferedTokens.empty(); mBufferedTokens.pop_front())
+      co_yield mBufferedTokens.front();
+  }
+}
+
+#endif //__cpp_impl_coroutine
+
+typedef basic_preprocessor_lexer<utf8_input_traits> preprocessor_lexer;
+typedef basic_preprocessor_lexer<ascii_input_traits> ascii_preprocessor_lexer;
+
+/**
+ * Tokenises the specified buffer into the specified sink, see push_tokens, using the
+ * lexer specialised for ASCII input when the buffer cannot contain any characters
+ * outside the basic source character set.
+ */
+template<typename Sink>
+void tokenise(const char *input, size_t length, Sink &sink, unsigned int flags = PPLEX_DEFAULT)
+{
+  if(is_ascii_source(input, length))
+  {
+    ascii_preprocessor_lexer lexer(input, length, flags);
+    lexer.push_tokens(sink);
+  }
+  else
+  {
+    preprocessor_lexer lexer(input, length, flags);
+    lexer.push_tokens(sink);
+  }
+}
+
 #endif //PREPROCESSOR_LEXER_H
@@ -0,0 +1,218 @@
+#ifndef PUNCTUATORS_H
+#define PUNCTUATORS_H
+
+#include <cstddef>
+
+//The preprocessing-op-or-punc tokens. See C++ standard 2.13 Operators and punctuators.
+//The alternative tokens are kept distinct from the tokens they stand for so that their
+//spelling is preserved. The symbolic punctuators come first, followed by those spelt
+//like identifiers.
+enum preprocessor_punctuator : unsigned char
+{
+  PUNC_NONE = 0,
+  PUNC_LBRACE,
+  PUNC_RBRACE,
+  PUNC_LSQUARE,
+  PUNC_RSQUARE,
+  PUNC_HASH,
+  PUNC_HASH_HASH,
+  PUNC_LPAREN,
+  PUNC_RPAREN,
+  PUNC_DIGRAPH_LSQUARE,       //<:
+  PUNC_DIGRAPH_RSQUARE,       //:>
+  PUNC_DIGRAPH_LBRACE,        //<%
+  PUNC_DIGRAPH_RBRACE,        //%>
+  PUNC_DIGRAPH_HASH,          //%:
+  PUNC_DIGRAPH_HASH_HASH,     //%:%:
+  PUNC_SEMICOLON,
+  PUNC_COLON,
+  PUNC_DOTS,
+  PUNC_QMARK,
+  PUNC_COLON2,
+  PUNC_DOT,
+  PUNC_DOTSTAR,
+  PUNC_PLUS,
+  PUNC_MINUS,
+  PUNC_STAR,
+  PUNC_DIV,
+  PUNC_MOD,
+  PUNC_XOR,
+  PUNC_AMP,
+  PUNC_BOR,
+  PUNC_COMPL,
+  PUNC_LNOT,
+  PUNC_ASS,
+  PUNC_LT,
+  PUNC_GT,
+  PUNC_PLUSASS,
+  PUNC_MINUSASS,
+  PUNC_STARASS,
+  PUNC_DIVASS,
+  PUNC_MODASS,
+  PUNC_XORASS,
+  PUNC_BANDASS,
+  PUNC_BORASS,
+  PUNC_LSHIFT,
+  PUNC_RSHIFT,
+  PUNC_RSHIFTASS,
+  PUNC_LSHIFTASS,
+  PUNC_EQ,
+  PUNC_NE,
+  PUNC_LE,
+  PUNC_GE,
+  PUNC_LAND,
+  PUNC_LOR,
+  PUNC_INC,
+  PUNC_DEC,
+  PUNC_COMMA,
+  PUNC_ARROWSTAR,
+  PUNC_ARROW,
+  PUNC_NEW,
+  PUNC_DELETE,
+  PUNC_ALT_AND,               //and
+  PUNC_ALT_AND_EQ,            //and_eq
+  PUNC_ALT_BITAND,            //bitand
+  PUNC_ALT_BITOR,             //bitor
+  PUNC_ALT_COMPL,             //compl
+  PUNC_ALT_NOT,               //not
+  PUNC_ALT_NOT_EQ,            //not_eq
+  PUNC_ALT_OR,                //or
+  PUNC_ALT_OR_EQ,             //or_eq
+  PUNC_ALT_XOR,               //xor
+  PUNC_ALT_XOR_EQ,            //xor_eq
+  PUNC_NUM_PUNCTUATORS
+};
+
+//The spelling of each punctuator
+constexpr const char *punctuator_spellings[PUNC_NUM_PUNCTUATORS] =
+{
+  "",
+  "{", "}", "[", "]", "#", "##", "(", ")",
+  "<:", ":>", "<%", "%>", "%:", "%:%:",
+  ";", ":", "...", "?", "::", ".", ".*",
+  "+", "-", "*", "/", "%", "^", "&", "|", "~", "!", "=", "<", ">",
+  "+=", "-=", "*=", "/=", "%=", "^=", "&=", "|=",
+  "<<", ">>", ">>=", "<<=", "==", "!=", "<=", ">=", "&&", "||", "++", "--",
+  ",", "->*", "->",
+  "new", "delete", "and", "and_eq", "bitand", "bitor", "compl",
+  "not", "not_eq", "or", "or_eq", "xor", "xor_eq"
+};
+
+//The identifier-like punctuators are recognised along with the keywords rather than by
+//the DFA
+const int num_symbolic_punctuators = PUNC_NEW;
+
+//The characters punctuators are made up of. Each has its own column in the DFA, and
+//every other character shares column 0 which has no transitions.
+constexpr const char *punctuator_alphabet = "{}[]#()<>%:;.?*+-/^&|~!=,";
+const unsigned int num_punctuator_columns = 26;
+
+/*
+ * Determines whether the first length characters of two spellings are the same.
+ */
+constexpr bool same_punctuator_prefix(const char *first, const char *second, size_t length)
+{
+  for(size_t i = 0; i < length; i++)
+  {
+    if(!first[i]
+       || first[i] != second[i])
+      return false;
+  }
+
+  return true;
+}
+
+/*
+ * Returns the number of states needed by the punctuator DFA: one for each distinct
+ * prefix of the spellings, plus the start state.
+ */
+constexpr size_t count_punctuator_states()
+{
+  size_t num_states = 1;
+
+  for(int punc = PUNC_NONE + 1; punc < num_symbolic_punctuators; punc++)
+  {
+    const char *spelling = punctuator_spellings[punc];
+
+    for(size_t length = 1; spelling[length - 1]; length++)
+    {
+      bool seen = false;
+
+      for(int earlier = PUNC_NONE + 1; earlier < punc && !seen; earlier++)
+        seen = same_punctuator_prefix(punctuator_spellings[earlier], spelling, length);
+
+      if(!seen)
+        num_states++;
+    }
+  }
+
+  return num_states;
+}
+
+const size_t num_punctuator_states = count_punctuator_states();
+
+//The maximal munch DFA over the punctuator spellings, a trie in which state 0 is the
+//start state. A transition to state 0 means no punctuator continues with that character.
+struct punctuator_dfa
+{
+  unsigned char columns[128];
+  unsigned char transitions[num_punctuator_states][num_punctuator_columns];
+
+  //The punctuator spelt by the path to each state, or PUNC_NONE for prefixes such as ..
+  //which aren't punctuators themselves
+  unsigned char accepts[num_punctuator_states];
+};
+
+/*
+ * Builds the punctuator DFA from the spellings.
+ */
+constexpr punctuator_dfa make_punctuator_dfa()
+{
+  punctuator_dfa dfa = {};
+
+  for(unsigned int i = 0; punctuator_alphabet[i]; i++)
+    dfa.columns[(unsigned char)punctuator_alphabet[i]] = i + 1;
+
+  unsigned int num_states = 1;
+
+  for(int punc = PUNC_NONE + 1; punc < num_symbolic_punctuators; punc++)
+  {
+    unsigned int state = 0;
+
+    for(const char *ch = punctuator_spellings[punc]; *ch; ch++)
+    {
+      unsigned char &next_state = dfa.transitions[state][dfa.columns[(unsigned char)*ch]];
+
+      if(!next_state)
+        next_state = num_states++;
+
+      state = next_state;
+    }
+
+    dfa.accepts[state] = punc;
+  }
+
+  return dfa;
+}
+
+constexpr punctuator_dfa punctuator_automaton = make_punctuator_dfa();
+
+/*
+ * Returns the state reached from the specified state on the specified character, or 0
+ * if there's no transition.
+ */
+inline unsigned int punctuator_transition(unsigned int state, int ch)
+{
+  unsigned int column = (unsigned int)ch < 128 ? punctuator_automaton.columns[ch] : 0;
+  return punctuator_automaton.transitions[state][column];
+}
+
+/*
+ * Returns the punctuator spelt by the path to the specified state, if any.
+ */
+inline preprocessor_punctuator punctuator_accepted(unsigned int state)
+{
+  return (preprocessor_punctuator)punctuator_automaton.accepts[state];
+}
+
+#endif //PUNCTUATORS_H
@@ -0,0 +1,120 @@
+#ifndef TOKEN_BUFFER_H
+#define TOKEN_BUFFER_H
+
+#include <vector>
+#include <string>
+#include <iterator>
+#include <cstddef>
+#include <cstdint>
+using std::vector;
+using std::string;
+
+#include "preprocessor/preprocessor_lexer.h"
+#include "util/arena.h"
+
+//Returns the bit representing the specified token type in a token type mask
+inline unsigned int token_type_bit(preprocessor_token_type type)
+{
+  return 1u << type;
+}
+
+//The tokens of a whole translation unit, with each field of the tokens held in its own
+//contiguous array. Passes which only look at the token types, such as skipping
+//whitespace, then touch nothing else and can be vectorised.
+class token_buffer
+{
+private:
+
+  arena_vector<preprocessor_token_type> mTypes;
+  arena_vector<uint8_t> mFlags;
+  arena_vector<preprocessor_punctuator> mPunctuators;
+  arena_vector<preprocessor_keyword> mKeywords;
+  arena_vector<uint32_t> mOffsets;
+  arena_vector<uint32_t> mLengths;
+  arena_vector<symbol_id> mSymbols;
+
+  //The input the spellings of clean tokens are spans of, and the spellings of the rest.
+  //See basic_preprocessor_lexer::spelling.
+  const char *mInput;
+  arena_string mSpellingArena;
+
+public:
+
+  //Random access iterator over the tokens, which are reassembled from the arrays
+  class const_iterator
+  {
+  private:
+
+    const token_buffer *mBuffer;
+    size_t mIndex;
+
+  public:
+
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef preprocessor_token value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const preprocessor_token *pointer;
+    typedef preprocessor_token reference;
+
+    const_iterator(const token_buffer *buffer, size_t index) : mBuffer(buffer), mIndex(index) {}
+
+    preprocessor_token operator*() const { return (*mBuffer)[mIndex]; }
+    preprocessor_token operator[](std::ptrdiff_t n) const { return (*mBuffer)[mIndex + n]; }
+
+    const_iterator &operator++() { ++mIndex; return *this; }
+    const_iterator &operator--() { --mIndex; return *this; }
+    const_iterator operator++(int) { const_iterator prev = *this; ++mIndex; return prev; }
+    const_iterator operator--(int) { const_iterator prev = *this; --mIndex; return prev; }
+    const_iterator &operator+=(std::ptrdiff_t n) { mIndex += n; return *this; }
+    const_iterator &operator-=(std::ptrdiff_t n) { mIndex -= n; return *this; }
+    const_iterator operator+(std::ptrdiff_t n) const { return const_iterator(mBuffer, mIndex + n); }
+    const_iterator operator-(std::ptrdiff_t n) const { return const_iterator(mBuffer, mIndex - n); }
+    std::ptrdiff_t operator-(const const_iterator &other) const { return (std::ptrdiff_t)mIndex - (std::ptrdiff_t)other.mIndex; }
+
+    bool operator==(const const_iterator &other) const { return mIndex == other.mIndex; }
+    bool operator!=(const const_iterator &other) const { return mIndex != other.mIndex; }
+    bool operator<(const const_iterator &other) const { return mIndex < other.mIndex; }
+    bool operator>(const const_iterator &other) const { return mIndex > other.mIndex; }
+    bool operator<=(const const_iterator &other) const { return mIndex <= other.mIndex; }
+    bool operator>=(const const_iterator &other) const { return mIndex >= other.mIndex; }
+
+    //Index of the token within the buffer
+    size_t index() const { return mIndex; }
+  };
+
+  token_buffer() : mInput(nullptr) {}
+  token_buffer(arena &memory);
+
+  //Spellings may point into the buffer itself so it can't be copied
+  token_buffer(const token_buffer&) = delete;
+  token_buffer &operator=(const token_buffer&) = delete;
+
+  size_t size() const { return mTypes.size(); }
+  bool empty() const { return mTypes.empty(); }
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size()); }
+
+  //The individual fields of a token
+  preprocessor_token_type type(size_t index) const { return mTypes[index]; }
+  uint8_t flags(size_t index) const { return mFlags[index]; }
+  preprocessor_punctuator punctuator(size_t index) const { return mPunctuators[index]; }
+  preprocessor_keyword keyword(size_t index) const { return mKeywords[index]; }
+  symbol_id symbol(size_t index) const { return mSymbols[index]; }
+
+  //The array of token types, for passes over the types alone
+  const preprocessor_token_type *types() const { return mTypes.data(); }
+
+  preprocessor_token operator[](size_t index) const;
+  token_spelling spelling(size_t index) const;
+
+  void reserve(size_t num_tokens);
+  void push_back(const preprocessor_token &tok);
+  void append(const preprocessor_token *tokens, size_t count);
+  void clear();
+  void set_spellings(const char *input, arena_string spellings);
+
+  void select(unsigned int type_mask, arena_vector<uint32_t> &indices) const;
+};
+
+#endif //TOKEN_BUFFER_H
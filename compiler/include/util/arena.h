@@ -0,0 +1,139 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+/**
+ * Monotonic allocator for everything belonging to one translation unit. Memory is
+ * carved sequentially out of large blocks mapped directly from the OS, individual
+ * allocations are never freed, and all of it is returned in one go when the arena is
+ * released or destroyed. Containers using it need not be destroyed first.
+ */
+class arena
+{
+private:
+
+  //Header at the start of each block
+  struct block
+  {
+    block *next;
+    size_t size;
+  };
+
+  block *mBlocks;
+
+  //The unused part of the block currently being allocated from
+  char *mCurr;
+  char *mEnd;
+
+  size_t mBlockSize;
+  size_t mBytesAllocated;
+
+  void *allocate_slow(size_t size, size_t alignment);
+  block *map_block(size_t size);
+
+public:
+
+  static const size_t default_block_size = 4 * 1024 * 1024;
+
+  arena(size_t block_size = default_block_size);
+  ~arena();
+
+  //Owns the blocks so can't be copied
+  arena(const arena&) = delete;
+  arena &operator=(const arena&) = delete;
+
+  /*
+   * Allocates the specified number of bytes. Alignment must be a power of 2.
+   */
+  void *allocate(size_t size, size_t alignment)
+  {
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(mCurr) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    uintptr_t end = reinterpret_cast<uintptr_t>(mEnd);
+
+    if(mCurr
+       && aligned <= end
+       && size <= end - aligned)
+    {
+      mCurr = reinterpret_cast<char*>(aligned + size);
+      mBytesAllocated += size;
+      return reinterpret_cast<void*>(aligned);
+    }
+
+    return allocate_slow(size, alignment);
+  }
+
+  void release();
+
+  //Total size of the allocations made since the arena was last released
+  size_t bytes_allocated() const { return mBytesAllocated; }
+};
+
+/**
+ * Standard allocator which allocates from an arena, so standard containers can be
+ * placed in one. Without an arena it falls back to the global heap, so containers can
+ * use the one allocator type whether or not an arena is in use.
+ */
+template<typename T>
+class arena_allocator
+{
+private:
+
+  arena *mArena;
+
+public:
+
+  typedef T value_type;
+
+  //Containers adopt the arena of the container moved or swapped into them
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  arena_allocator(arena *memory = nullptr) noexcept : mArena(memory) {}
+
+  template<typename U>
+  arena_allocator(const arena_allocator<U> &other) noexcept : mArena(other.memory()) {}
+
+  T *allocate(size_t n)
+  {
+    if(n > SIZE_MAX / sizeof(T))
+      throw std::bad_alloc();
+
+    if(mArena)
+      return static_cast<T*>(mArena->allocate(n * sizeof(T), alignof(T)));
+
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T *p, size_t) noexcept
+  {
+    if(!mArena)
+      ::operator delete(p);
+  }
+
+  arena *memory() const { return mArena; }
+};
+
+template<typename T, typename U>
+bool operator==(const arena_allocator<T> &first, const arena_allocator<U> &second)
+{
+  return first.memory() == second.memory();
+}
+
+template<typename T, typename U>
+bool operator!=(const arena_allocator<T> &first, const arena_allocator<U> &second)
+{
+  return first.memory() != second.memory();
+}
+
+typedef std::basic_string<char, std::char_traits<char>, arena_allocator<char>> arena_string;
+
+template<typename T>
+using arena_vector = std::vector<T, arena_allocator<T>>;
+
+#endif //ARENA_H
@@ -0,0 +1,29 @@
+#ifndef BYTE_SCAN_H
+#define BYTE_SCAN_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+using std::vector;
+
+//Size of the blocks classified by find_clean_blocks
+const size_t clean_block_size = 64;
+
+//byte_scan.cpp
+void find_clean_blocks(const char *data, size_t length, vector<uint64_t> &clean_blocks);
+bool is_ascii_source(const char *data, size_t length);
+size_t identifier_run_length(const char *data, size_t length);
+size_t whitespace_run_length(const char *data, size_t length);
+size_t literal_run_length(const char *data, size_t length, char quote);
+
+/*
+ * Determines whether the block containing the specified offset was marked as clean by
+ * find_clean_blocks.
+ */
+inline bool in_clean_block(const vector<uint64_t> &clean_blocks, size_t offset)
+{
+  size_t block = offset / clean_block_size;
+  return (clean_blocks[block / 64] >> (block % 64)) & 1;
+}
+
+#endif //BYTE_SCAN_H
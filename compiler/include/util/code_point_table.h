@@ -0,0 +1,151 @@
+#ifndef CODE_POINT_TABLE_H
+#define CODE_POINT_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+
+//An inclusive range of code points
+struct code_point_range
+{
+  int first;
+  int last;
+};
+
+//Code points are split into pages of 256. The final page is a clear page which all
+//code points beyond U+10FFFF, and negative values, are mapped to.
+const unsigned int code_point_page_bits = 8;
+const unsigned int num_code_point_pages = (0x10FFFF >> code_point_page_bits) + 2;
+const unsigned int out_of_range_code_point_page = num_code_point_pages - 1;
+
+//The membership bits of a page of code points
+struct code_point_page
+{
+  uint64_t bits[4];
+
+  constexpr bool operator==(const code_point_page &other) const
+  {
+    return bits[0] == other.bits[0]
+           && bits[1] == other.bits[1]
+           && bits[2] == other.bits[2]
+           && bits[3] == other.bits[3];
+  }
+};
+
+/**
+ * A set of code points held as a two level paged bitmap. The upper bits of a code point
+ * select one of NumPages distinct pages, so the many pages which are entirely in or out
+ * of the set are shared, and the lower 8 bits select a bit within the page.
+ */
+template<size_t NumPages>
+struct code_point_table
+{
+  uint8_t page_index[num_code_point_pages];
+  code_point_page pages[NumPages];
+
+  bool contains(int ch) const
+  {
+    unsigned int page = (unsigned int)ch >> code_point_page_bits;
+    page = page < out_of_range_code_point_page ? page : out_of_range_code_point_page;
+
+    return (pages[page_index[page]].bits[(ch >> 6) & 3] >> (ch & 63)) & 1;
+  }
+};
+
+/**
+ * Returns the bits of a 64 bit word covering the code points [word_first, word_first + 63]
+ * which fall within the range.
+ */
+constexpr uint64_t code_point_range_word(const code_point_range &range, int word_first)
+{
+  int first = range.first > word_first ? range.first - word_first : 0;
+  int last = range.last < word_first + 63 ? range.last - word_first : 63;
+
+  if(first > last)
+    return 0;
+
+  uint64_t upper = last == 63 ? ~uint64_t(0) : (uint64_t(1) << (last + 1)) - 1;
+  return upper & ~((uint64_t(1) << first) - 1);
+}
+
+/**
+ * Builds the page holding the code points of the specified page number that fall within
+ * any of the ranges.
+ */
+template<size_t NumRanges>
+constexpr code_point_page make_code_point_page(const code_point_range (&ranges)[NumRanges], unsigned int page)
+{
+  code_point_page result = {{ 0, 0, 0, 0 }};
+
+  if(page == out_of_range_code_point_page)
+    return result;
+
+  int page_first = (int)(page << code_point_page_bits);
+  int page_last = page_first + (1 << code_point_page_bits) - 1;
+
+  for(size_t i = 0; i < NumRanges; i++)
+  {
+    if(ranges[i].last < page_first
+       || ranges[i].first > page_last)
+      continue;
+
+    for(int word = 0; word < 4; word++)
+      result.bits[word] |= code_point_range_word(ranges[i], page_first + word * 64);
+  }
+
+  return result;
+}
+
+/**
+ * Counts the distinct pages needed to hold the ranges, which is the NumPages of the
+ * table built from them.
+ */
+template<size_t NumRanges>
+constexpr size_t count_code_point_pages(const code_point_range (&ranges)[NumRanges])
+{
+  code_point_page distinct[256] = {};
+  size_t num_distinct = 0;
+
+  for(unsigned int page = 0; page < num_code_point_pages; page++)
+  {
+    code_point_page bits = make_code_point_page(ranges, page);
+    size_t i = 0;
+
+    while(i < num_distinct && !(distinct[i] == bits))
+      i++;
+
+    if(i == num_distinct)
+      distinct[num_distinct++] = bits;
+  }
+
+  return num_distinct;
+}
+
+/**
+ * Builds the paged bitmap holding the code points within any of the ranges.
+ */
+template<size_t NumPages, size_t NumRanges>
+constexpr code_point_table<NumPages> make_code_point_table(const code_point_range (&ranges)[NumRanges])
+{
+  static_assert(NumPages <= 256, "Too many distinct pages for an 8 bit page index");
+
+  code_point_table<NumPages> table = {};
+  size_t num_distinct = 0;
+
+  for(unsigned int page = 0; page < num_code_point_pages; page++)
+  {
+    code_point_page bits = make_code_point_page(ranges, page);
+    size_t i = 0;
+
+    while(i < num_distinct && !(table.pages[i] == bits))
+      i++;
+
+    if(i == num_distinct)
+      table.pages[num_distinct++] = bits;
+
+    table.page_index[page] = i;
+  }
+
+  return table;
+}
+
+#endif //CODE_POINT_TABLE_H
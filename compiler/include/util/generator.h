@@ -0,0 +1,220 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+//Only available when building as C++20 or later, see the STD make variable
+#ifdef __cpp_impl_coroutine
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <cstddef>
+#include <new>
+
+/**
+ * Recycles coroutine frames. Frames are only ever allocated and freed on the thread
+ * which runs the coroutine, so each thread keeps its own list of freed frames, which are
+ * reused by the next coroutine needing a frame no larger than them. Only a few frames are
+ * kept, and they are freed when the thread exits.
+ */
+class coroutine_frame_pool
+{
+private:
+
+  //A freed frame, holding the size it was allocated with
+  struct free_frame
+  {
+    free_frame *next;
+    size_t size;
+  };
+
+  //The freed frames kept by a thread, which owns them and frees them on exit
+  struct frame_cache
+  {
+    free_frame *mFrames;
+    size_t mNumFrames;
+
+    frame_cache() : mFrames(nullptr), mNumFrames(0) {}
+
+    ~frame_cache()
+    {
+      while(mFrames)
+      {
+        free_frame *frame = mFrames;
+        mFrames = frame->next;
+        ::operator delete(frame);
+      }
+
+      //Anything freed later during thread exit is deleted rather than cached
+      mNumFrames = max_cached_frames;
+    }
+  };
+
+  //Frames are allocated in multiples of this size, so the frames of coroutines whose
+  //sizes differ slightly can still be reused for one another
+  static const size_t frame_granularity = 64;
+
+  //Most frames a thread keeps for reuse. Generators are rarely nested deeply.
+  static const size_t max_cached_frames = 8;
+
+  static inline thread_local frame_cache mCache;
+
+  static size_t rounded_size(size_t size)
+  {
+    return (size + frame_granularity - 1) & ~(frame_granularity - 1);
+  }
+
+public:
+
+  static void *allocate(size_t size)
+  {
+    size = rounded_size(size);
+
+    for(free_frame **link = &mCache.mFrames; *link; link = &(*link)->next)
+    {
+      if((*link)->size >= size)
+      {
+        free_frame *frame = *link;
+        *link = frame->next;
+        mCache.mNumFrames--;
+        return frame;
+      }
+    }
+
+    return ::operator new(size);
+  }
+
+  static void deallocate(void *frame, size_t size)
+  {
+    if(mCache.mNumFrames >= max_cached_frames)
+    {
+      ::operator delete(frame);
+      return;
+    }
+
+    free_frame *freed = static_cast<free_frame*>(frame);
+    freed->next = mCache.mFrames;
+    freed->size = rounded_size(size);
+    mCache.mFrames = freed;
+    mCache.mNumFrames++;
+  }
+};
+
+/**
+ * A coroutine which lazily produces a sequence of values, resuming only when the next
+ * value is pulled. Each value is only valid until the next one is pulled.
+ */
+template<typename T>
+class generator
+{
+public:
+
+  struct promise_type
+  {
+    //The value passed to the latest co_yield, which lives until the coroutine resumes
+    const T *mValue = nullptr;
+    std::exception_ptr mException;
+
+    generator get_return_object() { return generator(std::coroutine_handle<promise_type>::from_promise(*this)); }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+
+    std::suspend_always yield_value(const T &value) noexcept
+    {
+      mValue = &value;
+      return {};
+    }
+
+    void return_void() {}
+    void unhandled_exception() { mException = std::current_exception(); }
+
+    static void *operator new(size_t size) { return coroutine_frame_pool::allocate(size); }
+    static void operator delete(void *frame, size_t size) { coroutine_frame_pool::deallocate(frame, size); }
+  };
+
+  //Input iterator over the values, for use with range based for loops
+  class iterator
+  {
+  private:
+
+    generator *mGenerator;
+
+  public:
+
+    typedef std::input_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T *pointer;
+    typedef const T &reference;
+
+    explicit iterator(generator *gen) : mGenerator(gen) {}
+
+    const T &operator*() const { return mGenerator->value(); }
+    const T *operator->() const { return &mGenerator->value(); }
+
+    iterator &operator++()
+    {
+      if(!mGenerator->next())
+        mGenerator = nullptr;
+
+      return *this;
+    }
+
+    bool operator==(const iterator &other) const { return mGenerator == other.mGenerator; }
+    bool operator!=(const iterator &other) const { return mGenerator != other.mGenerator; }
+  };
+
+private:
+
+  std::coroutine_handle<promise_type> mCoroutine;
+
+  explicit generator(std::coroutine_handle<promise_type> coroutine) : mCoroutine(coroutine) {}
+
+public:
+
+  generator(generator &&other) noexcept : mCoroutine(other.mCoroutine) { other.mCoroutine = nullptr; }
+
+  generator &operator=(generator &&other) noexcept
+  {
+    if(this != &other)
+    {
+      if(mCoroutine)
+        mCoroutine.destroy();
+
+      mCoroutine = other.mCoroutine;
+      other.mCoroutine = nullptr;
+    }
+
+    return *this;
+  }
+
+  ~generator()
+  {
+    if(mCoroutine)
+      mCoroutine.destroy();
+  }
+
+  /*
+   * Resumes the coroutine until it produces its next value, returning false once it has
+   * finished. Any exception thrown by the coroutine is rethrown here.
+   */
+  bool next()
+  {
+    mCoroutine.resume();
+
+    if(mCoroutine.promise().mException)
+      std::rethrow_exception(mCoroutine.promise().mException);
+
+    return !mCoroutine.done();
+  }
+
+  //The value most recently produced
+  const T &value() const { return *mCoroutine.promise().mValue; }
+
+  iterator begin() { return next() ? iterator(this) : end(); }
+  iterator end() { return iterator(nullptr); }
+};
+
+#endif //__cpp_impl_coroutine
+
+#endif //GENERATOR_H
@@ -0,0 +1,38 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+using std::string;
+
+//Read-only memory mapping of an entire file. The contents are paged in on demand by
+//the kernel so the file is never copied into the process. Anything other than a regular
+//file, such as a pipe or terminal, can't be mapped so is read into memory instead.
+class mapped_file
+{
+private:
+
+  //Start of the mapping and its length in bytes
+  const char *mData;
+  size_t mSize;
+
+  //Contents of a file which isn't a regular file, which mData points to instead
+  string mContents;
+
+public:
+
+  mapped_file(const string &path);
+  ~mapped_file();
+
+  //Owns the mapping so can't be copied
+  mapped_file(const mapped_file&) = delete;
+  mapped_file &operator=(const mapped_file&) = delete;
+
+  const char *data() const { return mData; }
+  size_t size() const { return mSize; }
+};
+
+//mapped_file.cpp
+string read_file_descriptor(int fd, const string &name);
+
+#endif //MAPPED_FILE_H
@@ -0,0 +1,63 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <cstddef>
+#include <stdexcept>
+
+/**
+ * A fixed capacity FIFO queue held inline, for short lookahead buffers which would
+ * otherwise need a heap backed deque. Capacity must be a power of 2.
+ */
+template<typename T, size_t Capacity>
+class ring_buffer
+{
+private:
+
+  static_assert((Capacity & (Capacity - 1)) == 0, "ring_buffer capacity must be a power of 2");
+
+  T mItems[Capacity];
+  size_t mHead;
+  size_t mSize;
+
+public:
+
+  ring_buffer() : mHead(0), mSize(0) {}
+
+  bool empty() const { return mSize == 0; }
+  size_t size() const { return mSize; }
+
+  T &front() { return mItems[mHead]; }
+  T &operator[](size_t index) { return mItems[(mHead + index) & (Capacity - 1)]; }
+
+  void push_back(const T &item)
+  {
+    if(mSize == Capacity)
+      throw std::length_error("ring_buffer capacity exceeded");
+
+    mItems[(mHead + mSize++) & (Capacity - 1)] = item;
+  }
+
+  void push_front(const T &item)
+  {
+    if(mSize == Capacity)
+      throw std::length_error("ring_buffer capacity exceeded");
+
+    mHead = (mHead - 1) & (Capacity - 1);
+    mItems[mHead] = item;
+    mSize++;
+  }
+
+  void pop_front()
+  {
+    mHead = (mHead + 1) & (Capacity - 1);
+    mSize--;
+  }
+
+  void clear()
+  {
+    mHead = 0;
+    mSize = 0;
+  }
+};
+
+#endif //RING_BUFFER_H
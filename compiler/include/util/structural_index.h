@@ -0,0 +1,56 @@
+#ifndef STRUCTURAL_INDEX_H
+#define STRUCTURAL_INDEX_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+using std::vector;
+
+//Classes of byte recorded by the structural index, each kept as one bit per input byte
+enum structural_kind
+{
+  SI_IDENTIFIER = 0,      //A nondigit or digit from the basic source character set
+  SI_WHITESPACE,          //Horizontal whitespace: space, tab, vertical tab, form feed, carriage return
+  SI_TRIGGER,             //A byte which may start a phase 1 or 2 transformation: ?, \ or >= 0x80
+  SI_DOUBLE_QUOTE,
+  SI_SINGLE_QUOTE,
+  SI_STAR,
+  SI_NEW_LINE,
+  SI_NUM_KINDS
+};
+
+//Bitmasks locating the interesting bytes of a whole input, built in a single vectorised
+//pass (stage 1). The lexer then finds the end of identifier, whitespace, literal and
+//comment runs by searching the masks (stage 2) rather than by looking at each byte.
+class structural_index
+{
+private:
+
+  //The masks for each 64 byte block of the input, stored together so that a search
+  //touches one cache line per block. Bits past the end of the input are clear.
+  vector<uint64_t> mMasks;
+  size_t mLength;
+
+  uint64_t mask(size_t block, structural_kind kind) const
+  {
+    return mMasks[block * SI_NUM_KINDS + kind];
+  }
+
+public:
+
+  structural_index(const char *data, size_t length);
+
+  /*
+   * Determines whether the byte at the specified offset is of the specified kind.
+   */
+  bool is(structural_kind kind, size_t offset) const
+  {
+    return (mask(offset / 64, kind) >> (offset % 64)) & 1;
+  }
+
+  size_t next(structural_kind kind, size_t offset) const;
+  size_t next_of(structural_kind first, structural_kind second, size_t offset) const;
+  size_t next_not(structural_kind kind, size_t offset) const;
+};
+
+#endif //STRUCTURAL_INDEX_H
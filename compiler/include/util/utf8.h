@@ -1,10 +1,35 @@
 #ifndef UTF8_H
 #define UTF8_H
 
+#include <cstddef>
+
+//Maximum number of code units a single code point is encoded as
+const size_t max_utf8_code_units = 4;
+
+//Returned instead of an error offset when the input is valid UTF-8
+const size_t utf8_no_error = (size_t)-1;
+
+//The UTF-8 encoding of a single code point. Held by value so encoding never allocates.
+struct utf8_code_units
+{
+  char data[max_utf8_code_units];
+  size_t length;
+
+  const char *begin() const { return data; }
+  const char *end() const { return data + length; }
+};
+
 //utf8.cpp
-int encode_to_utf8(unsigned int code_point);
-int decode_from_utf8(vector<unsigned char> code_units);
+size_t utf8_sequence_length(unsigned char lead);
+size_t well_formed_sequence_length(const unsigned char *units, size_t available);
+
+size_t encode_utf8(unsigned int code_point, char *out);
+utf8_code_units encode_utf8(unsigned int code_point);
+
+unsigned int decode_utf8(const char *code_units, size_t length);
+unsigned int decode_utf8(const utf8_code_units &code_units);
 
-void utf8_code_point_to_code_units(int code_point, vector<unsigned char> &code_units);
+size_t validate_utf8(const char *data, size_t length);
+size_t decode_utf8_to_utf32(const char *data, size_t length, char32_t *out, size_t &num_code_points);
 
 #endif
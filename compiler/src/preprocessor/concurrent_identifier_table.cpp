@@ -0,0 +1,222 @@
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+using namespace std;
+
+#include "preprocessor/identifier_table.h"
+#include "preprocessor/concurrent_identifier_table.h"
+
+/**
+ * Returns the value stored in a slot for the specified symbol.
+ */
+static uint64_t slot_entry(uint64_t hash, symbol_id sym)
+{
+  return (hash & 0xffffffff00000000ull) | (uint64_t(sym) + 1);
+}
+
+concurrent_identifier_table::concurrent_identifier_table()
+  : mSymbolChunks(new atomic<symbol*>[max_symbol_chunks]()),
+    mNumSymbols(0),
+    mShards(new shard[num_shards])
+{
+  for(unsigned int i = 0; i < num_shards; i++)
+  {
+    shard &sh = mShards[i];
+    sh.all_slots.emplace_back(new shard_slots{ 63, unique_ptr<atomic<uint64_t>[]>(new atomic<uint64_t>[64]()) });
+    sh.slots.store(sh.all_slots.back().get(), memory_order_relaxed);
+    sh.num_symbols = 0;
+    sh.spelling_block = nullptr;
+    sh.spelling_block_used = spelling_block_size;
+  }
+}
+
+concurrent_identifier_table::~concurrent_identifier_table()
+{
+  for(size_t chunk = 0; chunk < max_symbol_chunks; chunk++)
+    delete[] mSymbolChunks[chunk].load(memory_order_relaxed);
+}
+
+/**
+ * Searches the specified slots for an identifier, returning its symbol or no_symbol if
+ * it isn't there. In that case empty_slot is set to the slot it would be inserted in.
+ */
+symbol_id concurrent_identifier_table::probe(const shard_slots *slots, const char *spelling, size_t length,
+                                             uint64_t hash, size_t &empty_slot) const
+{
+  for(size_t slot = hash & slots->mask;; slot = (slot + 1) & slots->mask)
+  {
+    uint64_t entry = slots->slots[slot].load(memory_order_acquire);
+
+    if(entry == 0)
+    {
+      empty_slot = slot;
+      return no_symbol;
+    }
+
+    if((entry >> 32) == (hash >> 32))
+    {
+      symbol_id sym = (uint32_t)entry - 1;
+      const symbol &candidate = symbol_at(sym);
+
+      if(candidate.length == length
+         && memcmp(candidate.spelling, spelling, length) == 0)
+        return sym;
+    }
+  }
+}
+
+/**
+ * Replaces a shard's slots with twice as many. Called with the shard locked, so no
+ * other slots are being inserted into.
+ */
+concurrent_identifier_table::shard_slots *concurrent_identifier_table::grow(shard &sh)
+{
+  const shard_slots *old_slots = sh.slots.load(memory_order_relaxed);
+  size_t num_slots = (old_slots->mask + 1) * 2;
+
+  sh.all_slots.emplace_back(new shard_slots{ num_slots - 1, unique_ptr<atomic<uint64_t>[]>(new atomic<uint64_t>[num_slots]()) });
+  shard_slots *new_slots = sh.all_slots.back().get();
+
+  for(size_t i = 0; i <= old_slots->mask; i++)
+  {
+    uint64_t entry = old_slots->slots[i].load(memory_order_relaxed);
+
+    if(entry == 0)
+      continue;
+
+    size_t slot = symbol_at((uint32_t)entry - 1).hash & new_slots->mask;
+
+    while(new_slots->slots[slot].load(memory_order_relaxed))
+      slot = (slot + 1) & new_slots->mask;
+
+    new_slots->slots[slot].store(entry, memory_order_relaxed);
+  }
+
+  sh.slots.store(new_slots, memory_order_release);
+  return new_slots;
+}
+
+/**
+ * Copies an identifier's spelling into the shard's spelling blocks. Called with the
+ * shard locked.
+ */
+const char *concurrent_identifier_table::store_spelling(shard &sh, const char *spelling, size_t length)
+{
+  //Long identifiers get a block to themselves
+  if(length > spelling_block_size / 4)
+  {
+    sh.spelling_blocks.emplace_back(new char[length]);
+    memcpy(sh.spelling_blocks.back().get(), spelling, length);
+    return sh.spelling_blocks.back().get();
+  }
+
+  if(sh.spelling_block_used + length > spelling_block_size)
+  {
+    sh.spelling_blocks.emplace_back(new char[spelling_block_size]);
+    sh.spelling_block = sh.spelling_blocks.back().get();
+    sh.spelling_block_used = 0;
+  }
+
+  char *stored = sh.spelling_block + sh.spelling_block_used;
+  memcpy(stored, spelling, length);
+  sh.spelling_block_used += length;
+
+  return stored;
+}
+
+/**
+ * Returns the specified chunk of symbols, allocating it if no thread has yet.
+ */
+concurrent_identifier_table::symbol *concurrent_identifier_table::symbol_chunk(size_t chunk)
+{
+  symbol *symbols = mSymbolChunks[chunk].load(memory_order_acquire);
+
+  if(!symbols)
+  {
+    symbol *allocated = new symbol[symbol_chunk_size];
+
+    if(mSymbolChunks[chunk].compare_exchange_strong(symbols, allocated, memory_order_acq_rel))
+      symbols = allocated;
+    else
+      delete[] allocated;
+  }
+
+  return symbols;
+}
+
+/**
+ * Returns the symbol of the specified identifier, interning it if it hasn't been seen
+ * before. Symbols are dense, but the order in which identifiers interned by different
+ * threads at once are numbered is unspecified.
+ */
+symbol_id concurrent_identifier_table::intern(const char *spelling, size_t length)
+{
+  uint64_t hash = hash_identifier(spelling, length);
+  shard &sh = shard_for(hash);
+  size_t slot;
+
+  symbol_id sym = probe(sh.slots.load(memory_order_acquire), spelling, length, hash, slot);
+
+  if(sym != no_symbol)
+    return sym;
+
+  lock_guard<mutex> lock(sh.insert_mutex);
+
+  //Another thread may have inserted it, or replaced the slots, in the meantime
+  shard_slots *slots = sh.slots.load(memory_order_relaxed);
+  sym = probe(slots, spelling, length, hash, slot);
+
+  if(sym != no_symbol)
+    return sym;
+
+  if(length > UINT32_MAX)
+    throw length_error("Identifier too long");
+
+  if((sh.num_symbols + 1) * 2 > slots->mask + 1)
+  {
+    slots = grow(sh);
+    probe(slots, spelling, length, hash, slot);
+  }
+
+  sym = mNumSymbols.fetch_add(1, memory_order_relaxed);
+
+  if(sym >= no_symbol - 1)
+    throw length_error("Too many identifiers");
+
+  symbol &entry = symbol_chunk(sym >> symbol_chunk_bits)[sym & (symbol_chunk_size - 1)];
+  entry.spelling = store_spelling(sh, spelling, length);
+  entry.length = length;
+  entry.hash = hash;
+
+  //Publishes the symbol to lookups on other threads
+  slots->slots[slot].store(slot_entry(hash, sym), memory_order_release);
+  sh.num_symbols++;
+
+  return sym;
+}
+
+/**
+ * Returns the symbol of the specified identifier, or no_symbol if it hasn't been
+ * interned. Never blocks.
+ */
+symbol_id concurrent_identifier_table::find(const char *spelling, size_t length) const
+{
+  uint64_t hash = hash_identifier(spelling, length);
+  size_t slot;
+
+  return probe(shard_for(hash).slots.load(memory_order_acquire), spelling, length, hash, slot);
+}
+
+/**
+ * Returns the table shared by every lexer in the process which is given the
+ * PPLEX_SHARED_IDENTIFIERS flag.
+ */
+concurrent_identifier_table &shared_identifier_table()
+{
+  static concurrent_identifier_table table;
+  return table;
+}
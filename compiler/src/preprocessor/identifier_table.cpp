@@ -0,0 +1,134 @@
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+using namespace std;
+
+#include "preprocessor/identifier_table.h"
+
+/**
+ * Hashes an identifier's spelling eight bytes at a time, mixing each word in with a
+ * multiply and folding the high bits back down.
+ */
+uint64_t hash_identifier(const char *spelling, size_t length)
+{
+  const uint64_t multiplier = 0x9e3779b97f4a7c15ull;
+  uint64_t hash = length * multiplier;
+
+  for(; length >= 8; spelling += 8, length -= 8)
+  {
+    uint64_t word;
+    memcpy(&word, spelling, 8);
+    hash = (hash ^ word) * multiplier;
+    hash ^= hash >> 32;
+  }
+
+  if(length > 0)
+  {
+    uint64_t word = 0;
+    memcpy(&word, spelling, length);
+    hash = (hash ^ word) * multiplier;
+    hash ^= hash >> 32;
+  }
+
+  return hash;
+}
+
+/**
+ * Constructor. Sizes the table to hold the specified number of symbols before it has
+ * to grow.
+ */
+identifier_table::identifier_table(size_t expected_symbols)
+{
+  size_t num_slots = 16;
+
+  while(num_slots < expected_symbols * 2)
+    num_slots *= 2;
+
+  mSlots.resize(num_slots);
+  mSymbols.reserve(expected_symbols);
+}
+
+/**
+ * Returns the index of the slot holding the specified identifier, or of the empty slot
+ * where it would be inserted.
+ */
+size_t identifier_table::find_slot(const char *spelling, size_t length, uint64_t hash) const
+{
+  size_t mask = mSlots.size() - 1;
+
+  for(size_t slot = hash & mask;; slot = (slot + 1) & mask)
+  {
+    uint32_t entry = mSlots[slot];
+
+    if(entry == 0)
+      return slot;
+
+    const symbol &sym = mSymbols[entry - 1];
+
+    if(sym.hash == hash
+       && sym.length == length
+       && memcmp(mSpellings.data() + sym.offset, spelling, length) == 0)
+      return slot;
+  }
+}
+
+/**
+ * Doubles the number of slots, reinserting every symbol.
+ */
+void identifier_table::grow()
+{
+  vector<uint32_t> slots(mSlots.size() * 2);
+  size_t mask = slots.size() - 1;
+
+  for(uint32_t id = 0; id < mSymbols.size(); id++)
+  {
+    size_t slot = mSymbols[id].hash & mask;
+
+    while(slots[slot])
+      slot = (slot + 1) & mask;
+
+    slots[slot] = id + 1;
+  }
+
+  mSlots.swap(slots);
+}
+
+/**
+ * Returns the symbol of the specified identifier, interning it if it hasn't been seen
+ * before.
+ */
+symbol_id identifier_table::intern(const char *spelling, size_t length)
+{
+  uint64_t hash = hash_identifier(spelling, length);
+  size_t slot = find_slot(spelling, length, hash);
+
+  if(mSlots[slot])
+    return mSlots[slot] - 1;
+
+  if(mSymbols.size() >= no_symbol - 1
+     || mSpellings.length() + length > UINT32_MAX)
+    throw length_error("Too many identifiers");
+
+  symbol_id id = mSymbols.size();
+  mSymbols.push_back({ hash, (uint32_t)mSpellings.length(), (uint32_t)length });
+  mSpellings.append(spelling, length);
+
+  if(mSymbols.size() * 2 > mSlots.size())
+    grow();
+  else
+    mSlots[slot] = id + 1;
+
+  return id;
+}
+
+/**
+ * Returns the symbol of the specified identifier, or no_symbol if it hasn't been
+ * interned.
+ */
+symbol_id identifier_table::find(const char *spelling, size_t length) const
+{
+  size_t slot = find_slot(spelling, length, hash_identifier(spelling, length));
+  return mSlots[slot] ? mSlots[slot] - 1 : no_symbol;
+}
@@ -0,0 +1,180 @@
+#include <vector>
+#include <string>
+#include <cctype>
+#include <stdexcept>
+using namespace std;
+
+#include "util/code_point_table.h"
+#include "preprocessor/preprocessor_lexer_error.h"
+#include "preprocessor/preprocessor_chars.h"
+
+// See C++ standard 2.11 Identifiers and Appendix/Annex E.1
+constexpr code_point_range identifier_char_allowed_ranges[] =
+{
+  {0xA8,0xA8},
+  {0xAA,0xAA},
+  {0xAD,0xAD},
+  {0xAF,0xAF},
+  {0xB2,0xB5},
+  {0xB7,0xBA},
+  {0xBC,0xBE},
+  {0xC0,0xD6},
+  {0xD8,0xF6},
+  {0xF8,0xFF},
+  {0x100,0x167F},
+  {0x1681,0x180D},
+  {0x180F,0x1FFF},
+  {0x200B,0x200D},
+  {0x202A,0x202E},
+  {0x203F,0x2040},
+  {0x2054,0x2054},
+  {0x2060,0x206F},
+  {0x2070,0x218F},
+  {0x2460,0x24FF},
+  {0x2776,0x2793},
+  {0x2C00,0x2DFF},
+  {0x2E80,0x2FFF},
+  {0x3004,0x3007},
+  {0x3021,0x302F},
+  {0x3031,0x303F},
+  {0x3040,0xD7FF},
+  {0xF900,0xFD3D},
+  {0xFD40,0xFDCF},
+  {0xFDF0,0xFE44},
+  {0xFE47,0xFFFD},
+  {0x10000,0x1FFFD},
+  {0x20000,0x2FFFD},
+  {0x30000,0x3FFFD},
+  {0x40000,0x4FFFD},
+  {0x50000,0x5FFFD},
+  {0x60000,0x6FFFD},
+  {0x70000,0x7FFFD},
+  {0x80000,0x8FFFD},
+  {0x90000,0x9FFFD},
+  {0xA0000,0xAFFFD},
+  {0xB0000,0xBFFFD},
+  {0xC0000,0xCFFFD},
+  {0xD0000,0xDFFFD},
+  {0xE0000,0xEFFFD}
+};
+
+// See C++ standard 2.11 Identifiers and Appendix/Annex E.2
+constexpr code_point_range identifier_char_disallowed_initially_ranges[] =
+{
+  {0x300,0x36F},
+  {0x1DC0,0x1DFF},
+  {0x20D0,0x20FF},
+  {0xFE20,0xFE2F}
+};
+
+//The ranges above as paged bitmaps, generated at compile time
+constexpr auto identifier_char_allowed_table =
+  make_code_point_table<count_code_point_pages(identifier_char_allowed_ranges)>(identifier_char_allowed_ranges);
+
+constexpr auto identifier_char_disallowed_initially_table =
+  make_code_point_table<count_code_point_pages(identifier_char_disallowed_initially_ranges)>(identifier_char_disallowed_initially_ranges);
+
+/**
+ * Determines whether the specified character is a character in the range a-z or A-Z.
+ */
+bool is_identifier_non_digit(int ch)
+{
+  if(ch < 0x80)
+    return is_basic_identifier_non_digit(ch);
+
+  //Each universal-character-name in an identifier shall designate a character whose encoding in
+  //ISO 10646 falls into one of the ranges specified in E.1.
+  return identifier_char_allowed_table.contains(ch);
+}
+
+/*
+ * Determines whether the specified character is valid for inclusion in an identifier or not
+ */
+bool valid_identifier_char(int ch)
+{
+  return is_identifier_non_digit(ch)
+         || (ch >= '0' && ch <= '9');
+}
+
+/**
+ * Determines whether the specified character is allowed to start an
+ * identifier.
+ */
+bool valid_initial_identifier_char(int ch)
+{
+  //The initial element shall not be a
+  //universal-character-name designating a character whose encoding
+  //falls into one of the ranges specified in E.2.
+  return !identifier_char_disallowed_initially_table.contains(ch);
+}
+
+/**
+ * Returns the integer value of a hexadecimal digit.
+ */
+int hex_char_to_int_value(int c)
+{
+  switch (c)
+  {
+    case '0': return 0;
+    case '1': return 1;
+    case '2': return 2;
+    case '3': return 3;
+    case '4': return 4;
+    case '5': return 5;
+    case '6': return 6;
+    case '7': return 7;
+    case '8': return 8;
+    case '9': return 9;
+    case 'A': return 10;
+    case 'a': return 10;
+    case 'B': return 11;
+    case 'b': return 11;
+    case 'C': return 12;
+    case 'c': return 12;
+    case 'D': return 13;
+    case 'd': return 13;
+    case 'E': return 14;
+    case 'e': return 14;
+    case 'F': return 15;
+    case 'f': return 15;
+    default: throw preprocessor_lexer_error("hex_char_to_int_value of nonhex char");
+  }
+}
+
+/*
+ * Folds a trigraph character sequence into it's corresponding output character.
+ */
+int fold_trigraph(int ch)
+{
+  switch(ch)
+  {
+    case '=':
+      return '#';
+
+    case '/':
+      return '\\';
+
+    case '\'':
+      return '^';
+
+    case '(':
+      return '[';
+
+    case ')':
+      return ']';
+
+    case '!':
+      return '|';
+
+    case '<':
+      return '{';
+
+    case '>':
+      return '}';
+
+    case '-':
+      return '~';
+  }
+
+  throw preprocessor_lexer_error("Invalid trigraph character sequence.");
+}
@@ -0,0 +1,58 @@
+#include <string>
+#include <vector>
+#include <stdexcept>
+using namespace std;
+
+#include "preprocessor/preprocessor_lexer_error.h"
+#include "preprocessor/preprocessor_diagnostic.h"
+
+//The text of each preprocessor_diagnostic_code, which is also the message of the
+//preprocessor_lexer_error thrown for it when errors aren't being recovered from
+constexpr const char *diagnostic_texts[] =
+{
+  "Invalid UTF8 character",
+  "Truncated UTF8 character",
+  "New line in header name",
+  "Unterminated header name",
+  "Unterminated string literal",
+  "Unterminated character literal",
+  "Unterminated raw string literal",
+  "invalid characters in raw string delimiter",
+  "raw string delimiters cannot exceed 16 characters",
+  "Unexpected end of file found in comment"
+};
+
+static_assert(sizeof(diagnostic_texts) / sizeof(diagnostic_texts[0]) == PPDIAG_UNTERMINATED_COMMENT + 1,
+              "Every diagnostic code needs a text");
+
+const char *diagnostic_text(preprocessor_diagnostic_code code)
+{
+  return diagnostic_texts[code];
+}
+
+/**
+ * Formats the message for the diagnostic, giving the offset it was found at.
+ */
+string preprocessor_diagnostic::message() const
+{
+  return "offset " + to_string(offset) + ": " + diagnostic_text(code);
+}
+
+/**
+ * Reports an error found in the input. Without a list of diagnostics to record it in, the
+ * error is thrown as a preprocessor_lexer_error. Otherwise it is recorded, unless it
+ * repeats the last one recorded, as happens when the same input is read again after
+ * rewinding or peeking, and the caller recovers from it.
+ */
+void report_diagnostic(diagnostic_list *diagnostics, preprocessor_diagnostic_code code, size_t offset)
+{
+  if(!diagnostics)
+    throw preprocessor_lexer_error(diagnostic_text(code));
+
+  if(!diagnostics->empty()
+     && diagnostics->back().offset == offset
+     && diagnostics->back().code == code)
+    return;
+
+  diagnostics->push_back({ offset, code });
+}
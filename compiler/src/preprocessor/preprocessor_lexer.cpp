@@ -1,224 +1,40 @@
-#include <unordered_set>
-#include <iostream>
+#include <istream>
 #include <vector>
+#include <cstring>
+#include <algorithm>
 using namespace std;
 
 #include "util/utf8.h"
+#include "util/byte_scan.h"
 #include "preprocessor/preprocessor_lexer_error.h"
+#include "preprocessor/preprocessor_chars.h"
 #include "preprocessor/preprocessor_lexer.h"
+#include "preprocessor/token_buffer.h"
+#include "preprocessor/identifier_table.h"
+#include "preprocessor/concurrent_identifier_table.h"
 
-// See C++ standard 2.11 Identifiers and Appendix/Annex E.1
-const vector<pair<int, int>> identifier_char_allowed_ranges =
-{
-  {0xA8,0xA8},
-  {0xAA,0xAA},
-  {0xAD,0xAD},
-  {0xAF,0xAF},
-  {0xB2,0xB5},
-  {0xB7,0xBA},
-  {0xBC,0xBE},
-  {0xC0,0xD6},
-  {0xD8,0xF6},
-  {0xF8,0xFF},
-  {0x100,0x167F},
-  {0x1681,0x180D},
-  {0x180F,0x1FFF},
-  {0x200B,0x200D},
-  {0x202A,0x202E},
-  {0x203F,0x2040},
-  {0x2054,0x2054},
-  {0x2060,0x206F},
-  {0x2070,0x218F},
-  {0x2460,0x24FF},
-  {0x2776,0x2793},
-  {0x2C00,0x2DFF},
-  {0x2E80,0x2FFF},
-  {0x3004,0x3007},
-  {0x3021,0x302F},
-  {0x3031,0x303F},
-  {0x3040,0xD7FF},
-  {0xF900,0xFD3D},
-  {0xFD40,0xFDCF},
-  {0xFDF0,0xFE44},
-  {0xFE47,0xFFFD},
-  {0x10000,0x1FFFD},
-  {0x20000,0x2FFFD},
-  {0x30000,0x3FFFD},
-  {0x40000,0x4FFFD},
-  {0x50000,0x5FFFD},
-  {0x60000,0x6FFFD},
-  {0x70000,0x7FFFD},
-  {0x80000,0x8FFFD},
-  {0x90000,0x9FFFD},
-  {0xA0000,0xAFFFD},
-  {0xB0000,0xBFFFD},
-  {0xC0000,0xCFFFD},
-  {0xD0000,0xDFFFD},
-  {0xE0000,0xEFFFD}
-};
-
-// See C++ standard 2.11 Identifiers and Appendix/Annex E.2
-const vector<pair<int, int>> identifier_char_disallowed_initially_ranges =
-{
-  {0x300,0x36F},
-  {0x1DC0,0x1DFF},
-  {0x20D0,0x20FF},
-  {0xFE20,0xFE2F}
-};
-
-// See C++ standard 2.13 Operators and punctuators
-const unordered_set<string> identifier_like_operators =
-{
-  "new", "delete", "and", "and_eq", "bitand",
-  "bitor", "compl", "not", "not_eq", "or",
-  "or_eq", "xor", "xor_eq"
-};
-
-/**
- * Determines whether the specified character is a character in the range a-z or A-Z.
- */
-bool is_identifier_non_digit(int ch)
-{
-  switch(ch)
-  {
-    case 'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'g': case 'h': case 'i':
-    case 'j': case 'k': case 'l': case 'm': case 'n': case 'o': case 'p': case 'q': case 'r':
-    case 's': case 't': case 'u': case 'v': case 'w': case 'x': case 'y': case 'z':
-    case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G': case 'H': case 'I':
-    case 'J': case 'K': case 'L': case 'M': case 'N': case 'O': case 'P': case 'Q': case 'R':
-    case 'S': case 'T': case 'U': case 'V': case 'W': case 'X': case 'Y': case 'Z': case '_':
-      return true;
-
-    default:
-
-      //Each universal-character-name in an identifier shall designate a character whose encoding in
-      //ISO 10646 falls into one of the ranges specified in E.1.
-      for(auto elem : identifier_char_allowed_ranges)
-      {
-        if(ch >= elem.first
-            && ch <= elem.second)
-          return true;
-      }
-
-      return false;
-  }
-}
-
-/*
- * Determines whether the specified character is valid for inclusion in an identifier or not
- */
-bool valid_identifier_char(int ch)
-{
-  return is_identifier_non_digit(ch)
-         || isdigit(ch);
-}
-
-/**
- * Determines whether the specified character is allowed to start an
- * identifier.
- */
-bool valid_initial_identifier_char(int ch)
-{
-  //The initial element shall not be a
-  //universal-character-name designating a character whose encoding
-  //falls into one of the ranges specified in E.2.
-  for(auto elem : identifier_char_disallowed_initially_ranges)
-  {
-    if(ch >= elem.first
-        && ch <= elem.second)
-      return false;
-  }
-
-  return true;
-}
-
-/**
- * Returns the integer value of a hexadecimal digit.
- */
-int hex_char_to_int_value(int c)
-{
-  switch (c)
-  {
-    case '0': return 0;
-    case '1': return 1;
-    case '2': return 2;
-    case '3': return 3;
-    case '4': return 4;
-    case '5': return 5;
-    case '6': return 6;
-    case '7': return 7;
-    case '8': return 8;
-    case '9': return 9;
-    case 'A': return 10;
-    case 'a': return 10;
-    case 'B': return 11;
-    case 'b': return 11;
-    case 'C': return 12;
-    case 'c': return 12;
-    case 'D': return 13;
-    case 'd': return 13;
-    case 'E': return 14;
-    case 'e': return 14;
-    case 'F': return 15;
-    case 'f': return 15;
-    default: throw preprocessor_lexer_error("hex_char_to_int_value of nonhex char");
-  }
-}
-
-/*
- * Folds a trigraph character sequence into it's corresponding output character.
- */
-int fold_trigraph(int ch)
-{
-  switch(ch)
-  {
-    case '=':
-      return '#';
-
-    case '/':
-      return '\\';
-
-    case '\'':
-      return '^';
-
-    case '(':
-      return '[';
-
-    case ')':
-      return ']';
-
-    case '!':
-      return '|';
-
-    case '<':
-      return '{';
-
-    case '>':
-      return '}';
-
-    case '-':
-      return '~';
-  }
-
-  throw preprocessor_lexer_error("Invalid trigraph character sequence.");
-}
+template<typename InputTraits>
+const size_t basic_preprocessor_lexer<InputTraits>::stream_lookahead;
+template<typename InputTraits>
+const size_t basic_preprocessor_lexer<InputTraits>::default_stream_chunk_size;
 
 /**
  * Lexes and appends any user defined string literal suffix.
  */
-bool preprocessor_lexer::lex_user_defined_string_literal_suffix(string &lit)
+template<typename InputTraits>
+bool basic_preprocessor_lexer<InputTraits>::lex_user_defined_string_literal_suffix(string &lit)
 {
   int curr_ch = curr_char();
   bool user_defined_literal = false;
 
-  if(is_identifier_non_digit(curr_ch)
-     && valid_initial_identifier_char(curr_ch))
+  if(identifier_non_digit(curr_ch)
+     && initial_identifier_char(curr_ch))
   {
     user_defined_literal = true;
     append_curr_char_to_token_and_advance(lit);
 
     while(!end_of_buffer()
-          && valid_identifier_char(curr_char()))
+          && identifier_char(curr_char()))
       append_curr_char_to_token_and_advance(lit);
   }
 
@@ -237,22 +53,23 @@ bool preprocessor_lexer::lex_user_defined_string_literal_suffix(string &lit)
  * h-char:
  *   any member of the source character set except new-line and >
  */
-bool preprocessor_lexer::maybe_lex_header_name()
+template<typename InputTraits>
+bool basic_preprocessor_lexer<InputTraits>::maybe_lex_header_name()
 {
-  if(valid_identifier_char(curr_char())
-     && valid_initial_identifier_char(curr_char()))
+  if(identifier_char(curr_char())
+     && initial_identifier_char(curr_char()))
   {
     preprocessor_token identifier = lex_identifier();
-    mBufferedTokens.push_back(identifier);
+    emit_token(identifier);
 
-    if(identifier.data != "include")
+    if(spelling(identifier) != "include")
       return false;
 
     //Skip any whitespace
     if(isspace(curr_char()))
     {
       skip_whitespace();
-      mBufferedTokens.push_back(preprocessor_token(PPTOK_WHITESPACE));
+      emit_token(preprocessor_token(PPTOK_WHITESPACE));
     }
 
     //Save the current position of where we are in case this turns out not to be a header name
@@ -268,33 +85,48 @@ bool preprocessor_lexer::maybe_lex_header_name()
     //If we have a <, check it's followed by an identifier
     if(curr_char() == '<')
     {
-      int peeked_ch = peek_char();
+      int peeked_ch = peek_code_point();
 
-      if(!valid_identifier_char(peeked_ch))
+      if(!identifier_char(peeked_ch))
       {
         restore_saved_position();
         return false;
       }
     }
 
+    //This is a header name, so the lexer will never be rewound. When streaming, the
+    //window no longer has to keep the input from the saved position onwards.
+    discard_saved_position();
+
     int term_ch = curr_char() == '<' ? '>' : '"';
-    string header_name;
+    string &header_name = mSpelling;
+
+    begin_token();
     append_curr_char_to_token_and_advance(header_name);
 
     //Lex the h-char-sequence
     while(curr_char() != term_ch)
     {
+      if(end_of_buffer())
+      {
+        invalidate_token(PPDIAG_UNTERMINATED_HEADER_NAME);
+        break;
+      }
+
       append_curr_char_to_token_and_advance(header_name);
 
       if(curr_char() == '\n')
-        throw preprocessor_lexer_error("New line in header name");
+      {
+        invalidate_token(PPDIAG_NEW_LINE_IN_HEADER_NAME);
+        break;
+      }
     }
 
     //Append the terminating character
-    append_curr_char_to_token_and_advance(header_name);
+    if(!mTokenInvalid)
+      append_curr_char_to_token_and_advance(header_name);
 
-    discard_saved_position();
-    mBufferedTokens.push_back(preprocessor_token(header_name, PPTOK_HEADER_NAME));
+    emit_token(end_token(PPTOK_HEADER_NAME));
   }
 
   return true;
@@ -304,13 +136,12 @@ bool preprocessor_lexer::maybe_lex_header_name()
  * Determines if the current character marks the start of an encoding prefix for a
  * string literal.
  */
-bool preprocessor_lexer::start_of_encoding_prefix()
+template<typename InputTraits>
+bool basic_preprocessor_lexer<InputTraits>::start_of_encoding_prefix()
 {
   bool ret = false;
   int curr_ch = curr_char();
 
-  ++mSuppressTransformations;
-
   switch(curr_ch)
   {
     case 'u':
@@ -347,7 +178,6 @@ bool preprocessor_lexer::start_of_encoding_prefix()
     }
   }
 
-  --mSuppressTransformations;
   return ret;
 }
 
@@ -362,12 +192,11 @@ bool preprocessor_lexer::start_of_encoding_prefix()
  *  L
  *  LR
  */
-void preprocessor_lexer::lex_encoding_prefix(string &prefix)
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::lex_encoding_prefix(string &prefix)
 {
   int curr_ch = curr_char();
 
-  ++mSuppressTransformations;
-
   switch(curr_ch)
   {
     case 'u':
@@ -417,14 +246,13 @@ void preprocessor_lexer::lex_encoding_prefix(string &prefix)
       }
     }
   }
-
-  --mSuppressTransformations;
 }
 
 /**
  * Appends a variable number of characters to the specified token.
  */
-void preprocessor_lexer::append_chars_to_token_and_advance(string &tok, int count)
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::append_chars_to_token_and_advance(string &tok, int count)
 {
   for(int i = 0; i < count; i++)
     append_curr_char_to_token_and_advance(tok);
@@ -452,10 +280,14 @@ void preprocessor_lexer::append_chars_to_token_and_advance(string &tok, int coun
  *    and the control characters representing horizontal tab,
  *    vertical tab, form feed, and newline.
  */
-void preprocessor_lexer::lex_raw_string_literal_contents(string &literal)
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::lex_raw_string_literal_contents(string &literal)
 {
   ++mSuppressTransformations;
 
+  //Add the opening "
+  append_curr_char_to_token_and_advance(literal);
+
   //See if the string has a delimiter
   string delimiter;
 
@@ -464,98 +296,203 @@ void preprocessor_lexer::lex_raw_string_literal_contents(string &literal)
     //Check for invalid delimiter characters
     int curr_ch = curr_char();
 
-    if(curr_ch == ' '
-        || curr_ch == ')'
-        || curr_ch == '\\'
-        || curr_ch == '\t'
-        || curr_ch == '\v'
-        || curr_ch == '\f'
-        || curr_ch == '\n')
-      throw preprocessor_lexer_error("invalid characters in raw string delimiter");
+    if(end_of_buffer())
+    {
+      invalidate_token(PPDIAG_UNTERMINATED_RAW_STRING_LITERAL);
+      break;
+    }
+    else if(curr_ch == ' '
+            || curr_ch == ')'
+            || curr_ch == '\\'
+            || curr_ch == '\t'
+            || curr_ch == '\v'
+            || curr_ch == '\f'
+            || curr_ch == '\n')
+    {
+      //The invalid token ends before the invalid character
+      invalidate_token(PPDIAG_INVALID_RAW_STRING_DELIMITER);
+      break;
+    }
     else
       append_curr_char_to_token_and_advance(delimiter);
   }
 
-  //Delimiters are limited to 16 chars
-  if(delimiter.length() > 16)
-    throw preprocessor_lexer_error("raw string delimiters cannot exceed 16 characters");
-
-  //Add the delimiter and opening ( to the literal
   literal += delimiter;
-  append_curr_char_to_token_and_advance(literal);
 
-  //add the contents
+  if(!mTokenInvalid)
+  {
+    //Delimiters are limited to 16 chars. The body is still lexed when recovering, as the
+    //delimiter is unambiguous.
+    if(delimiter.length() > 16)
+      invalidate_token(PPDIAG_RAW_STRING_DELIMITER_TOO_LONG);
+
+    //Add the opening ( and the contents up to and including the terminating
+    //)d-char-sequence"
+    append_curr_char_to_token_and_advance(literal);
+    append_raw_string_body(literal, ")" + delimiter + "\"");
+  }
+
+  --mSuppressTransformations;
+}
+
+/**
+ * Appends the body of a raw string literal, up to and including the specified terminator.
+ * Phase 1 and 2 transformations are reverted within raw strings and well formed UTF-8
+ * decodes and re-encodes to the same bytes, so the terminator is found with a substring
+ * search and everything before it is copied straight from the input. Characters which
+ * have already been decoded or aren't well formed are appended one at a time; they're
+ * never ASCII so can't be part of the terminator.
+ */
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::append_raw_string_body(string &literal, const string &terminator)
+{
+  //Offset of the terminator from the start of the input, once it has been found. It's
+  //only searched for again if a character appended on its own runs over it. Until it
+  //has been found, the offset before which it's known not to start, so that no part of
+  //the input is searched more than once.
+  bool found = false;
+  size_t terminator_offset = 0;
+  size_t search_offset = 0;
+
   while(true)
   {
-    //See if this is the terminating d-char-sequence
-    if(curr_char() == ')')
+    if(!mTransformedChars.empty())
     {
       append_curr_char_to_token_and_advance(literal);
+      continue;
+    }
+
+    size_t available = mBufferEnd - mCurrPosition;
 
-      if(delimiter.length() == 0
-          && curr_char() == '\"')
+    if(!found
+       || position_offset() > terminator_offset)
+    {
+      size_t search_start = max(position_offset(), search_offset);
+      const char *search_pos = mBufferStart + (search_start - mWindowOffset);
+      const char *match = static_cast<const char*>(memmem(search_pos, mBufferEnd - search_pos,
+                                                          terminator.data(), terminator.length()));
+      found = match != nullptr;
+
+      if(found)
+        terminator_offset = search_start + (match - search_pos);
+      else
       {
-        append_curr_char_to_token_and_advance(literal);
-        break;
+        size_t window_end = mWindowOffset + (mBufferEnd - mBufferStart);
+        search_offset = max(search_start, window_end - min(window_end, terminator.length() - 1));
       }
-      else if(delimiter.length() > 0
-              && match_raw_string_delimiter(delimiter)
-              && nth_char(delimiter.length()) == '\"')
-      {
-        while(curr_char() != '\"')
-          append_curr_char_to_token_and_advance(literal);
+    }
 
-        append_curr_char_to_token_and_advance(literal);
-        break;
-      }
+    size_t body_length = available;
+
+    if(found)
+      body_length = terminator_offset - position_offset() + terminator.length();
+    else if(mStream)
+    {
+      //Leave anything which could be the start of the terminator, or part of a character,
+      //until after the window has been refilled
+      body_length -= terminator.length() - 1;
+
+      while(body_length > 0
+            && ((unsigned char)mCurrPosition[body_length] & 0xC0) == 0x80)
+        body_length--;
     }
-    else
+
+    size_t error_offset = InputTraits::ascii_only ? utf8_no_error : validate_utf8(mCurrPosition, body_length);
+
+    if(error_offset != utf8_no_error)
+    {
+      literal.append(mCurrPosition, error_offset);
+      mCurrPosition += error_offset;
+      ensure_lookahead();
+
       append_curr_char_to_token_and_advance(literal);
-  }
+      continue;
+    }
 
-  --mSuppressTransformations;
+    //An unterminated literal runs to the end of the input
+    bool unterminated = !found && !mStream;
+
+    if(unterminated)
+      invalidate_token(PPDIAG_UNTERMINATED_RAW_STRING_LITERAL);
+
+    literal.append(mCurrPosition, body_length);
+    mCurrPosition += body_length;
+    ensure_lookahead();
+
+    if(found
+       || unterminated)
+      break;
+  }
 }
 
 /**
- * Determines whether the sequence of chars starting at the current position
- * matches the specified raw string delimiter.
+ * Appends the run of characters at the current position which need no transformation and
+ * can't end the string or character literal being lexed with a single copy.
  */
-bool preprocessor_lexer::match_raw_string_delimiter(const string &delimiter)
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::append_literal_run(string &literal, char quote)
 {
-  unsigned int remaining_char_count = mBufferEnd - mCurrPosition;
+  if(!mTransformedChars.empty())
+    return;
 
-  if(remaining_char_count < delimiter.length())
-    return false;
+  size_t run_length = literal_run(mCurrPosition, quote);
 
-  return string(mCurrPosition, mCurrPosition + delimiter.length()) ==  delimiter;
+  if(run_length > 0)
+  {
+    literal.append(mCurrPosition, run_length);
+
+    //Step off the last character of the run with next_char so that the following
+    //character is transformed exactly as it would be when advancing one at a time
+    mCurrPosition += run_length - 1;
+    next_char();
+  }
 }
 
 /**
- * Lex's the contents of a string literal. Assumes that the leading prefix or " has
- * already been processed.
+ * Lex's a string literal, starting from the opening ". Assumes that any leading prefix
+ * has already been processed.
  */
-void preprocessor_lexer::lex_string_literal_contents(string &literal)
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::lex_string_literal_contents(string &literal)
 {
-  while(curr_char() != '\"')
+  //Comments aren't recognised from the opening " onwards
+  mInLiteral = true;
+  append_curr_char_to_token_and_advance(literal);
+
+  while(true)
   {
+    append_literal_run(literal, '\"');
+
+    int curr_ch = curr_char();
+
+    if(curr_ch == '\"')
+      break;
+
     if(end_of_buffer())
-      throw preprocessor_lexer_error("Unterminated string literal");
+    {
+      invalidate_token(PPDIAG_UNTERMINATED_STRING_LITERAL);
+      break;
+    }
 
-    if(curr_char() == '\\')
+    if(curr_ch == '\\')
       append_chars_to_token_and_advance(literal, 2);
     else
       append_curr_char_to_token_and_advance(literal);
   }
 
-  //add the closing "
-  append_curr_char_to_token_and_advance(literal);
+  //add the closing ", unless the literal ran to the end of the input
+  mInLiteral = false;
+
+  if(!end_of_buffer())
+    append_curr_char_to_token_and_advance(literal);
 }
 
 /**
  * Appends the character at the current position to the passed in token data
  * and advances forward one character.
  */
-void preprocessor_lexer::append_curr_char_to_token_and_advance(string &tok)
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::append_curr_char_to_token_and_advance(string &tok)
 {
   append_char_to_token(curr_char(), tok);
   next_char();
@@ -565,30 +502,16 @@ void preprocessor_lexer::append_curr_char_to_token_and_advance(string &tok)
  * Appends the specified character to the passed in token, performing
  * any UTF8 encoding/decoding as required.
  */
-void preprocessor_lexer::append_char_to_token(int ch, string &tok)
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::append_char_to_token(int ch, string &tok)
 {
-  if(ch < 0
-     || ch > 127)
-  {
-    //Have a UTF8 decoded character (> 127) or a UTF8 encoded character
-    //that's come from a UCN
-    vector<unsigned char> code_units;
-    unsigned int encoded_ch = ch < 0 ? ch : encode_to_utf8(ch);
-
-    //Convert the code point into it's code units for adding to the token
-    utf8_code_point_to_code_units(encoded_ch, code_units);
-
-    for(auto ch : code_units)
-      tok.append(1, (int)ch);
-  }
-  else if(ch > 127)
+  if(!InputTraits::ascii_only
+     && (ch < 0 || ch > 127))
   {
-    //Decoded UTF8 character
-    vector<unsigned char> code_units;
-    utf8_code_point_to_code_units(encode_to_utf8(ch), code_units);
-
-    for(auto ch : code_units)
-      tok.append(1, (int)ch);
+    //Have a UTF8 decoded character (> 127) or a UCN so append its code units. Characters
+    //which couldn't be decoded are spelt as the replacement character.
+    utf8_code_units code_units = encode_utf8(ch == invalid_code_point ? replacement_character : ch);
+    tok.append(code_units.data, code_units.length);
   }
   else
     tok.append(1, ch);
@@ -603,25 +526,70 @@ void preprocessor_lexer::append_char_to_token(int ch, string &tok)
  *   nondigit
  *   universal-character-name
  */
-preprocessor_token preprocessor_lexer::lex_identifier()
+template<typename InputTraits>
+preprocessor_token basic_preprocessor_lexer<InputTraits>::lex_identifier()
 {
-  string identifier;
+  string &identifier = mSpelling;
+  begin_token();
 
-  while(valid_identifier_char(curr_char()))
+  while(true)
   {
+    //Runs of basic source characters can't contain the start of a transformation so
+    //are measured in bulk and appended with a single copy
+    if(mTransformedChars.empty())
+    {
+      size_t run_length = identifier_run(mCurrPosition);
+
+      if(run_length > 0)
+      {
+        identifier.append(mCurrPosition, run_length);
+
+        //Step off the last character of the run with next_char so that the following
+        //character is transformed exactly as it would be when advancing one at a time
+        mCurrPosition += run_length - 1;
+        next_char();
+
+        if(end_of_buffer())
+          break;
+
+        continue;
+      }
+    }
+
+    if(!identifier_char(curr_char()))
+      break;
+
     append_curr_char_to_token_and_advance(identifier);
 
     if(end_of_buffer())
       break;
   }
 
-  //Check whether we have an operator before committing to this being an identifier
-  auto itr = identifier_like_operators.find(identifier);
+  //Check whether we have a keyword or an operator before committing to this being a
+  //plain identifier
+  const identifier_word *word = find_identifier_word(identifier.data(), identifier.length());
 
-  if(itr == identifier_like_operators.end())
-    return preprocessor_token(identifier, PPTOK_IDENTIFIER);
-  else
-    return preprocessor_token(identifier, PPTOK_PREPROCESSING_OP_OR_PUNC);
+  if(word
+     && word->punctuator != PUNC_NONE)
+  {
+    preprocessor_token tok(word->punctuator);
+    tok.keyword = word->keyword;
+    return tok;
+  }
+
+  preprocessor_token tok = end_token(PPTOK_IDENTIFIER);
+
+  if(word)
+    tok.keyword = word->keyword;
+
+  //The spelling has had any universal-character-names decoded, so each identifier has
+  //the same symbol however it was written
+  if(mIdentifierTable)
+    tok.symbol = mIdentifierTable->intern(identifier.data(), identifier.length());
+  else if(mConcurrentIdentifierTable)
+    tok.symbol = mConcurrentIdentifierTable->intern(identifier.data(), identifier.length());
+
+  return tok;
 }
 
 /**
@@ -634,9 +602,14 @@ preprocessor_token preprocessor_lexer::lex_identifier()
  * user-defined-character-literal:
  *   character-literal ud-suffix
  */
-preprocessor_token preprocessor_lexer::lex_char_literal(bool wide_literal)
+template<typename InputTraits>
+preprocessor_token basic_preprocessor_lexer<InputTraits>::lex_char_literal(bool wide_literal)
 {
-  string char_lit;
+  string &char_lit = mSpelling;
+  begin_token();
+
+  //Comments aren't recognised from the opening ' onwards
+  mInLiteral = true;
   append_curr_char_to_token_and_advance(char_lit);
 
   if(wide_literal)
@@ -644,38 +617,50 @@ preprocessor_token preprocessor_lexer::lex_char_literal(bool wide_literal)
 
   while(true)
   {
-    //If this character is a \, skip over the escape character
-    if(curr_char() == '\\')
+    append_literal_run(char_lit, '\'');
+
+    int curr_ch = curr_char();
+
+    //See if we've hit the terminating '
+    if(curr_ch == '\'')
+      break;
+
+    if(end_of_buffer())
     {
-      append_chars_to_token_and_advance(char_lit, 2);
-      continue;
+      invalidate_token(PPDIAG_UNTERMINATED_CHAR_LITERAL);
+      break;
     }
+
+    //If this character is a \, skip over the escape character
+    if(curr_ch == '\\')
+      append_chars_to_token_and_advance(char_lit, 2);
     else
       append_curr_char_to_token_and_advance(char_lit);
-
-    //See if we've hit the terminating '
-    if(*char_lit.rbegin() == '\'')
-      break;
   }
 
+  mInLiteral = false;
+
+  if(!end_of_buffer())
+    append_curr_char_to_token_and_advance(char_lit);
+
   //If we have the start of an identifier adjacent to the end ", we have a user defined
   //character literal
   bool user_defined_literal = false;
 
-  if(is_identifier_non_digit(curr_char()))
+  if(identifier_non_digit(curr_char()))
   {
     user_defined_literal = true;
     append_curr_char_to_token_and_advance(char_lit);
 
     while(!end_of_buffer()
-          && valid_identifier_char(curr_char()))
+          && identifier_char(curr_char()))
       append_curr_char_to_token_and_advance(char_lit);
   }
 
   if(user_defined_literal)
-    return preprocessor_token(char_lit, PPTOK_USER_DEF_CHAR_LITERAL);
+    return end_token(PPTOK_USER_DEF_CHAR_LITERAL);
   else
-    return preprocessor_token(char_lit, PPTOK_CHAR_LITERAL);
+    return end_token(PPTOK_CHAR_LITERAL);
 }
 
 /*
@@ -688,69 +673,149 @@ preprocessor_token preprocessor_lexer::lex_char_literal(bool wide_literal)
  *   pp-number E sign
  *   pp-number .
  */
-void preprocessor_lexer::lex_pp_number(string &num)
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::lex_pp_number(string &num)
 {
-  int curr_ch = curr_char();
-
-  if(isdigit(curr_ch))
+  while(true)
   {
-    while(isdigit(curr_char()))
+    int curr_ch = curr_char();
+
+    if(isdigit(curr_ch))
+    {
+      while(isdigit(curr_char()))
+        append_curr_char_to_token_and_advance(num);
+    }
+    else if(curr_ch == 'e'
+            || curr_ch == 'E')
+    {
       append_curr_char_to_token_and_advance(num);
 
-    lex_pp_number(num);
+      if(curr_char() == '+'
+          || curr_char() == '-')
+        append_curr_char_to_token_and_advance(num);
+    }
+    else if(curr_ch == '.'
+            || identifier_non_digit(curr_ch))
+      append_curr_char_to_token_and_advance(num);
+    else
+      break;
   }
-  else if(curr_ch == 'e'
-          || curr_ch == 'E')
+}
+
+/*
+ * Determines whether the / at the current position starts a comment. If it does, the
+ * current position is left at the / or * which follows it, and that character is
+ * returned. Otherwise 0 is returned. Line splices are deleted before comments are
+ * recognised, so may come between the two characters. The / is queued while they are
+ * deleted, as it stays a character of its own unless it does start a comment.
+ */
+template<typename InputTraits>
+int basic_preprocessor_lexer<InputTraits>::start_comment()
+{
+  if(line_splice_length(mCurrPosition + 1))
   {
-    append_curr_char_to_token_and_advance(num);
+    mTransformedChars.push_back('/');
+    ++mCurrPosition;
+    skip_line_splices();
 
-    if(curr_char() == '+'
-        || curr_char() == '-')
-      append_curr_char_to_token_and_advance(num);
+    int next_ch = raw_char(mCurrPosition);
 
-    lex_pp_number(num);
-  }
-  else if(curr_ch == '.'
-          || is_identifier_non_digit(curr_ch))
-  {
-    append_curr_char_to_token_and_advance(num);
-    lex_pp_number(num);
+    if(next_ch != '/'
+       && next_ch != '*')
+      return 0;
+
+    mTransformedChars.clear();
+    return next_ch;
   }
+
+  int next_ch = raw_char(mCurrPosition + 1);
+
+  if(next_ch != '/'
+     && next_ch != '*')
+    return 0;
+
+  ++mCurrPosition;
+  return next_ch;
 }
 
 /*
- * Skips a C++ style comment.
+ * Skips a C++ style comment, leaving the current position at the new-line which ends it.
+ * The comment is searched for new-lines in bulk, and only a new-line which ends a line
+ * splice needs to be looked at further.
  */
-void preprocessor_lexer::skip_cpp_comment()
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::skip_cpp_comment()
 {
-  while(*mCurrPosition != '\n')
+  //Step over the second / of the opening //
+  ++mCurrPosition;
+
+  while(true)
   {
-    if(end_of_buffer())
+    const char *new_line = find_byte(mCurrPosition, '\n', SI_NEW_LINE);
+
+    if(!new_line)
+    {
+      //The comment runs to the end of the buffer
+      mCurrPosition = mBufferEnd;
+
+      if(!mStream)
+        break;
+
+      refill_window();
+      continue;
+    }
+
+    mCurrPosition = new_line;
+    ensure_lookahead();
+
+    if(!ends_line_splice(mCurrPosition))
       break;
 
-    next_char();
+    ++mCurrPosition;
   }
 }
 
 /*
- * Skips over a C style comment.
+ * Skips over a C style comment, which starts at the specified offset. The comment is
+ * searched for * characters in bulk, and as a line splice is the only thing which can
+ * come between the * and / which end it, only the characters following each * need to be
+ * looked at.
  */
-void preprocessor_lexer::skip_c_comment()
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::skip_c_comment(size_t comment_start)
 {
+  //Step over the * of the opening /*
+  ++mCurrPosition;
+
   while(true)
   {
-    if(*mCurrPosition == '*'
-        && peek_char() == '/')
+    const char *star = find_byte(mCurrPosition, '*', SI_STAR);
+
+    if(!star)
     {
-      //Consume the '*/' sequence
-      skip_chars(2);
-      break;
+      mCurrPosition = mBufferEnd;
+
+      //A comment left open runs to the end of the input
+      if(!mStream)
+      {
+        report_error(PPDIAG_UNTERMINATED_COMMENT, comment_start);
+        break;
+      }
+
+      refill_window();
+      continue;
     }
-    else
-      next_char();
 
-    if(end_of_buffer())
-      throw preprocessor_lexer_error("Unexpected end of file found in comment");
+    mCurrPosition = star + 1;
+    skip_line_splices();
+
+    if(raw_char(mCurrPosition) == '/')
+    {
+      //Consume the '/' of the '*/' sequence
+      ++mCurrPosition;
+      ensure_lookahead();
+      break;
+    }
   }
 }
 
@@ -758,15 +823,29 @@ void preprocessor_lexer::skip_c_comment()
  * Advances the current character position until a non-whitespace character
  * that is not a new-line is found.
  */
-void preprocessor_lexer::skip_whitespace()
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::skip_whitespace()
 {
-  while(curr_char() == ' '
-        || curr_char() == '\t'
-        || curr_char() == '\v'
-        || curr_char() == '\f'
-        || curr_char() == '\r')
+  while(true)
   {
-    if(end_of_buffer())
+    //Runs of whitespace characters can't contain the start of a transformation or a
+    //comment so are skipped in bulk
+    if(mTransformedChars.empty())
+    {
+      size_t run_length = whitespace_run(mCurrPosition);
+
+      if(run_length > 0)
+      {
+        //Step off the last character of the run with next_char so that the following
+        //character is transformed exactly as it would be when advancing one at a time
+        mCurrPosition += run_length - 1;
+        next_char();
+        continue;
+      }
+    }
+
+    if(classify_char(curr_char()) != CHCLASS_WHITESPACE
+       || end_of_buffer())
       break;
 
     //next_char() will handle skipping over adjacent comments
@@ -777,7 +856,8 @@ void preprocessor_lexer::skip_whitespace()
 /*
  * Returns the next character and advances the current position.
  */
-int preprocessor_lexer::next_char()
+template<typename InputTraits>
+int basic_preprocessor_lexer<InputTraits>::next_char()
 {
   //Remove any buffered char
   if(!mTransformedChars.empty())
@@ -791,46 +871,171 @@ int preprocessor_lexer::next_char()
     {
       //In the case of buffered characters, the current position in the buffer
       //will already be pointing at the first character of the next character
+      ensure_lookahead();
       return curr_char();
     }
   }
   else
   {
     if(mCurrPosition == mBufferEnd)
-      return *mBufferEnd;
+      return '\0';
     else
     {
       ++mCurrPosition;
-     return curr_char();
+      ensure_lookahead();
+      return curr_char();
     }
   }
 }
 
+/**
+ * Moves the unconsumed part of the streaming window to its start and reads the next chunk
+ * of the input stream after it. Bytes from just before the current position (or the saved
+ * position, if earlier) onwards are kept so that lookahead and rewinds are unaffected; the
+ * window only grows when those bytes leave no room for another chunk. At least as many
+ * bytes are read as are kept, so a window grown to look past a long run of line splices
+ * doubles each time rather than being copied and scanned again for every chunk.
+ */
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::refill_window()
+{
+  const char *keep = mCurrPosition;
+
+  if(mCheckpoint.saved
+     && mCheckpoint.offset < position_offset())
+    keep = mBufferStart + (mCheckpoint.offset - mWindowOffset);
+
+  keep = (size_t)(keep - mBufferStart) > stream_lookahead ? keep - stream_lookahead : mBufferStart;
+
+  size_t kept = mBufferEnd - keep;
+  size_t curr_offset = mCurrPosition - keep;
+
+  if(kept > 0)
+    memmove(&mBuffer[0], keep, kept);
+
+  mWindowOffset += keep - mBufferStart;
+
+  size_t read_size = max(mStreamChunkSize, kept);
+
+  if(mBuffer.length() < kept + read_size)
+    mBuffer.resize(kept + read_size);
+
+  char *window = &mBuffer[0];
+  mStream->read(window + kept, read_size);
+  size_t bytes_read = mStream->gcount();
+
+  if(mStream->bad())
+    throw preprocessor_lexer_error("Error reading input");
+
+  //A short read means the end of the stream has been reached
+  if(bytes_read < read_size)
+    mStream = nullptr;
+
+  if(bytes_read > 0)
+    mHaveInput = true;
+
+  mBufferStart = window;
+  mBufferEnd = window + kept + bytes_read;
+  mCurrPosition = window + curr_offset;
+
+  if(mUseCleanBlocks)
+    find_clean_blocks(mBufferStart, mBufferEnd - mBufferStart, mCleanBlocks);
+}
+
+/**
+ * Sets up the lexer for the specified combination of preprocessor_lexer_flags.
+ */
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::apply_flags(unsigned int flags)
+{
+  //Tokens refer to their spellings by 32 bit offsets
+  if((size_t)(mBufferEnd - mBufferStart) > UINT32_MAX)
+    throw preprocessor_lexer_error("Input too large");
+
+  if(flags & PPLEX_SHARED_IDENTIFIERS)
+    intern_identifiers(shared_identifier_table());
+
+  if(flags & PPLEX_RECOVER_ERRORS)
+    mRecoverErrors = true;
+
+  if(flags & PPLEX_STRUCTURAL_INDEX)
+    mStructuralIndex.reset(new structural_index(mBufferStart, mBufferEnd - mBufferStart));
+  else if(!(flags & PPLEX_NO_CLEAN_BLOCK_FAST_PATH))
+  {
+    mUseCleanBlocks = true;
+    find_clean_blocks(mBufferStart, mBufferEnd - mBufferStart, mCleanBlocks);
+  }
+}
+
+/**
+ * Sets up the lexer for the specified combination of preprocessor_lexer_flags when lexing
+ * a stream. Clean blocks are found in each chunk as it is read rather than up front.
+ */
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::apply_stream_flags(unsigned int flags)
+{
+  if(flags & PPLEX_STRUCTURAL_INDEX)
+    throw preprocessor_lexer_error("Streamed input cannot be indexed up front");
+
+  if(flags & PPLEX_SHARED_IDENTIFIERS)
+    intern_identifiers(shared_identifier_table());
+
+  if(flags & PPLEX_RECOVER_ERRORS)
+    mRecoverErrors = true;
+
+  mUseCleanBlocks = !(flags & PPLEX_NO_CLEAN_BLOCK_FAST_PATH);
+}
+
 /**
  * Accessor for the current character after any transformations have been applied to it.
  */
-int preprocessor_lexer::curr_char()
+template<typename InputTraits>
+int basic_preprocessor_lexer<InputTraits>::curr_char()
 {
   if(!mTransformedChars.empty())
     return mTransformedChars.front();
-  else
+
+  //A character within a clean block, or which the structural index shows isn't a trigger
+  //byte, can't start a phase 1 or 2 transformation so only needs checking for the start
+  //of a comment
+  if(mCurrPosition < mBufferEnd
+     && untransformed_char(mCurrPosition))
   {
-    int ch = apply_transformations(*mCurrPosition);
+    int raw_ch = *mCurrPosition;
 
-    if(!mTransformedChars.empty())
-      ch = mTransformedChars.front();
+    if(raw_ch != '/'
+       || mSuppressTransformations
+       || mInLiteral)
+      return raw_ch;
+  }
 
-    return ch;
+  size_t offset = position_offset();
+  int ch = apply_transformations(raw_char(mCurrPosition));
+
+  //Nested calls made while transforming record later offsets, so this is assigned after
+  //them to leave the offset the pending characters start at
+  if(!mTransformedChars.empty())
+  {
+    mTransformedOffset = offset;
+    ch = mTransformedChars.front();
   }
+
+  return ch;
 }
 
 /**
- * Accesses the character at the specified distance from the current position.
+ * Accesses the character at the specified distance from the current position. Line splices
+ * are deleted before the input is split into tokens, so they're looked past. The
+ * transformations which delete them need to see the raw input though, so while
+ * transformations are suppressed the raw character is returned instead.
  */
-int preprocessor_lexer::nth_char(unsigned int pos)
+template<typename InputTraits>
+int basic_preprocessor_lexer<InputTraits>::nth_char(unsigned int pos)
 {
   if(mTransformedChars.size() > pos)
     return mTransformedChars[pos];
+  else if(!mSuppressTransformations)
+    return raw_char(lookahead_position(pos));
   else
   {
     pos -= mTransformedChars.size();
@@ -838,14 +1043,57 @@ int preprocessor_lexer::nth_char(unsigned int pos)
     if(mCurrPosition + pos > mBufferEnd)
       throw preprocessor_lexer_error("Attempt to access past end of input");
 
-    return *(mCurrPosition + pos);
+    return raw_char(mCurrPosition + pos);
   }
 }
 
+/**
+ * Returns the character after the current one. Where peek_char only gives the first code
+ * unit of a character outside the basic source character set, the whole character is
+ * decoded, giving invalid_code_point if it isn't well formed.
+ */
+template<typename InputTraits>
+int basic_preprocessor_lexer<InputTraits>::peek_code_point()
+{
+  int ch = peek_char();
+
+  if(InputTraits::ascii_only
+     || ch >= 0)
+    return ch;
+
+  const unsigned char *pos = reinterpret_cast<const unsigned char*>(lookahead_position(1));
+  size_t num_code_units = well_formed_sequence_length(pos, mBufferEnd - reinterpret_cast<const char*>(pos));
+
+  return num_code_units != 0 ? decode_utf8(reinterpret_cast<const char*>(pos), num_code_units) : invalid_code_point;
+}
+
+/**
+ * Returns the position in the raw input of the character at the specified distance from
+ * the current one, which must be past any pending transformed characters, skipping the
+ * line splices before it.
+ */
+template<typename InputTraits>
+const char *basic_preprocessor_lexer<InputTraits>::lookahead_position(unsigned int pos)
+{
+  //A distance rather than a pointer, as refilling the window moves the input
+  size_t ahead = 0;
+
+  //An untransformed current character has already been found past the splices before
+  //it. Otherwise the raw input after the pending characters may start with some.
+  if(!mTransformedChars.empty())
+    ahead = skip_lookahead_splices(0);
+
+  for(unsigned int i = mTransformedChars.size(); i < pos; i++)
+    ahead = skip_lookahead_splices(ahead + 1);
+
+  return mCurrPosition + ahead;
+}
+
 /**
  * Advances the current buffer position by the specified number of characters.
  */
-void preprocessor_lexer::skip_chars(unsigned int count)
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::skip_chars(unsigned int count)
 {
   if(!mTransformedChars.empty())
   {
@@ -873,28 +1121,29 @@ void preprocessor_lexer::skip_chars(unsigned int count)
  * - Line splicing
  * - Replacement of C/C++ style comments to a single space character
  */
-int preprocessor_lexer::apply_transformations(int ch)
+template<typename InputTraits>
+int basic_preprocessor_lexer<InputTraits>::apply_transformations(int ch)
 {
   //Decode any UTF8 code unit sequences
-  if(ch < 0)
+  if(!InputTraits::ascii_only
+     && ch < 0)
   {
-    vector<unsigned char> code_units;
-    unsigned int num_code_units;
-    unsigned char uch = (unsigned char)ch;
-
-    if(uch <= 0xDF)
-      num_code_units = 2;
-    else if(uch <= 0xEF)
-      num_code_units = 3;
-    else if(uch <= 0xF7)
-      num_code_units = 4;
-    else
-      throw new preprocessor_lexer_error("Invalid UTF8 character");
+    size_t available = mBufferEnd - mCurrPosition;
+    size_t num_code_units = well_formed_sequence_length(reinterpret_cast<const unsigned char*>(mCurrPosition), available);
 
-    for(unsigned int i = 0; i < num_code_units; i++)
-      code_units.push_back(*mCurrPosition++);
+    //Lone continuation bytes, overlong encodings, surrogates and truncated sequences are
+    //all errors. When recovering, the byte is skipped on its own.
+    if(num_code_units == 0)
+    {
+      report_error(utf8_sequence_length((unsigned char)ch) > available ? PPDIAG_TRUNCATED_UTF8 : PPDIAG_INVALID_UTF8,
+                   position_offset());
+      ch = invalid_code_point;
+      num_code_units = 1;
+    }
+    else
+      ch = decode_utf8(mCurrPosition, num_code_units);
 
-    ch = decode_from_utf8(code_units);
+    mCurrPosition += num_code_units;
     mTransformedChars.push_back(ch);
   }
 
@@ -905,18 +1154,19 @@ int preprocessor_lexer::apply_transformations(int ch)
   //characters otherwise we could end up in an infinite loop
   ++mSuppressTransformations;
 
-  //Skip any comemnts
-  if(ch == '/'
-     && peek_char() == '/')
+  //Skip any comments, which aren't recognised within string and character literals
+  size_t comment_start = position_offset();
+  int opener_ch = ch == '/' && !mInLiteral ? start_comment() : 0;
+
+  if(opener_ch == '/')
   {
     skip_cpp_comment();
     ch = ' ';
     mTransformedChars.push_back(ch);
   }
-  else if(ch == '/'
-          && peek_char() == '*')
+  else if(opener_ch == '*')
   {
-    skip_c_comment();
+    skip_c_comment(comment_start);
     ch = ' ';
     mTransformedChars.push_back(ch);
   }
@@ -931,8 +1181,13 @@ int preprocessor_lexer::apply_transformations(int ch)
 /**
  * Applies the transformations listed in phase 1 in section 2.2.
  */
-void preprocessor_lexer::apply_phase_one_transformations(int &ch)
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::apply_phase_one_transformations(int &ch)
 {
+  //ASCII only input has no trigraphs or UCNs
+  if(InputTraits::ascii_only)
+    return;
+
   //2.2.1 - Trigraph sequences are replaced by corresponding single-character internal representations.
   if(ch == '?')
   {
@@ -953,10 +1208,11 @@ void preprocessor_lexer::apply_phase_one_transformations(int &ch)
           || third_ch == '>'
           || third_ch == '-')
       {
-        //Skip the trigraph sequence and fold it to its corresponding character
+        //Skip the trigraph sequence and fold it to its corresponding character. It comes
+        //before anything decoded from the input following it while skipping.
         skip_chars(3);
         ch = fold_trigraph(third_ch);
-        mTransformedChars.push_back(ch);
+        mTransformedChars.push_front(ch);
       }
     }
   }
@@ -966,8 +1222,11 @@ void preprocessor_lexer::apply_phase_one_transformations(int &ch)
     int peeked_ch = peek_char();
     unsigned int code_unit = 0;
 
-    //Save the current position in case we find that this is not a UCN
-    string::const_iterator save_point = mCurrPosition;
+    //Save the current position, and any characters already transformed from the input
+    //before it, in case we find that this is not a UCN. Reading the hex digits may
+    //decode the character after them, so the queue has to be restored as well.
+    size_t save_point = position_offset();
+    ring_buffer<int, 8> saved_chars = mTransformedChars;
 
     if(peeked_ch == 'u')
     {
@@ -976,10 +1235,13 @@ void preprocessor_lexer::apply_phase_one_transformations(int &ch)
       if(maybe_lex_utf8_code_units(4, code_unit))
       {
         ch = code_unit;
-        mTransformedChars.push_back(ch);
+        mTransformedChars.push_front(ch);
       }
       else
-        mCurrPosition = save_point;
+      {
+        set_position_offset(save_point);
+        mTransformedChars = saved_chars;
+      }
     }
     else if(peeked_ch == 'U')
     {
@@ -988,10 +1250,13 @@ void preprocessor_lexer::apply_phase_one_transformations(int &ch)
       if(maybe_lex_utf8_code_units(8, code_unit))
       {
         ch = code_unit;
-        mTransformedChars.push_back(ch);
+        mTransformedChars.push_front(ch);
       }
       else
-        mCurrPosition = save_point;
+      {
+        set_position_offset(save_point);
+        mTransformedChars = saved_chars;
+      }
     }
   }
 }
@@ -999,7 +1264,8 @@ void preprocessor_lexer::apply_phase_one_transformations(int &ch)
 /**
  * Lexes a UTF16 code unit.
  */
-bool preprocessor_lexer::maybe_lex_utf16_code_unit(unsigned short &code_unit)
+template<typename InputTraits>
+bool basic_preprocessor_lexer<InputTraits>::maybe_lex_utf16_code_unit(unsigned short &code_unit)
 {
   for(int i = 0; i < 4; i++)
   {
@@ -1060,7 +1326,8 @@ bool preprocessor_lexer::maybe_lex_utf16_code_unit(unsigned short &code_unit)
  *
  * Returns true if the required number of code units was lexed, otherwise false.
  */
-bool preprocessor_lexer::maybe_lex_utf8_code_units(unsigned int num_code_units, unsigned int &code_point)
+template<typename InputTraits>
+bool basic_preprocessor_lexer<InputTraits>::maybe_lex_utf8_code_units(unsigned int num_code_units, unsigned int &code_point)
 {
   for(unsigned int i = num_code_units / 4; i > 0; i--)
   {
@@ -1082,7 +1349,8 @@ bool preprocessor_lexer::maybe_lex_utf8_code_units(unsigned int num_code_units,
 /**
  * Applies the transformations listed in phase 2 in section 2.2.
  */
-void preprocessor_lexer::apply_phase_two_transformations(int &ch)
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::apply_phase_two_transformations(int &ch)
 {
   //2.2.1 - Each instance of a backslash character (\) immediately followed by a new-line
   //character is deleted.
@@ -1095,347 +1363,187 @@ void preprocessor_lexer::apply_phase_two_transformations(int &ch)
       //the current char to the final new line
       skip_chars(2);
 
+      //Skip any further splices directly following here rather than by transforming the
+      //following character recursively, so a run of splices needs no more stack than one
+      while(mTransformedChars.empty())
+      {
+        size_t splice_length = line_splice_length(mCurrPosition);
+
+        if(!splice_length)
+          break;
+
+        mCurrPosition += splice_length;
+        ensure_lookahead();
+      }
+
+      //The following character is transformed in full, as it may start a comment
       if(end_of_buffer())
-        ch = *mBufferEnd;
+        ch = '\0';
       else
+      {
+        --mSuppressTransformations;
         ch = curr_char();
+        ++mSuppressTransformations;
+      }
     }
   }
 }
 
 /**
-* Scans the next token or sequence of tokens.
-*/
-void preprocessor_lexer::scan_next_token()
+ * Lexes a preprocessing-op-or-punc starting with the specified character. The longest
+ * punctuator is found by following the punctuator DFA, so no spelling is built up.
+ */
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::lex_punctuator(int curr_ch, bool header_name_allowed)
 {
-  if(!end_of_buffer())
+  //2.5.3 - Otherwise, if the next three characters are <:: and the subsequent character is
+  //neither : nor >, the < is treated as a preprocessor token by itself and not as the first
+  //character of the alternative token <:
+  if(curr_ch == '<'
+     && peek_char() == ':'
+     && nth_char(2) == ':'
+     && nth_char(3) != ':'
+     && nth_char(3) != '>')
   {
-    bool header_name_allowed = mLastChar == -1 || mLastChar == '\n';
-    int curr_ch = curr_char();
-    mLastChar = curr_ch;
-
-    switch(curr_ch)
-    {
-      case '#':
-      {
-        string tok;
-        tok.append(1, curr_ch);
-
-        int peeked_ch = peek_char();
-
-        if(peeked_ch == '#')
-        {
-          skip_chars(2);
-          tok.append(1, peeked_ch);
-
-          mBufferedTokens.push_back(preprocessor_token(tok, PPTOK_PREPROCESSING_OP_OR_PUNC));
-        }
-        else
-        {
-          //Buffer the # token
-          next_char();
-
-          preprocessor_token hash_tok({(char)curr_ch}, PPTOK_PREPROCESSING_OP_OR_PUNC);
-          mBufferedTokens.push_back(hash_tok);
-
-          if(header_name_allowed)
-            maybe_lex_header_name();
-        }
-
-        break;
-      }
-
-      case '<':
-      {
-        string tok;
-        append_curr_char_to_token_and_advance(tok);
-
-        //May be <, <<, <<=, <=, <: or <%
-        if(curr_char() == ':')
-        {
-          //<::: is tokenised as '<:' and '::'
-          //<::> is tokenised as '<:' and ':>'
-          //<::! is tokenised as '<', '::' and '!'
-          //<:   is tokenised as '<:'
-          if(peek_char() != ':')
-          {
-            append_curr_char_to_token_and_advance(tok);
-            mBufferedTokens.push_back(preprocessor_token(tok, PPTOK_PREPROCESSING_OP_OR_PUNC));
-          }
-          else
-          {
-            //We have <::
-            //2.5.3 - Otherwise, if the next three characters are <:: and the subsequent character is
-            //neither : nor >, the < is treated as a preprocessor token by itself and not as the first
-            //character of the alternative token <:
-            if(nth_char(2) != ':'
-                && nth_char(2) != '>')
-            {
-              //The < needs to be treated as a separate pre-processing token
-              //and not the start of a <: alternate token
-              mBufferedTokens.push_back(preprocessor_token(tok, PPTOK_PREPROCESSING_OP_OR_PUNC));
-            }
-            else
-            {
-              //Append the : to form a <: token
-              append_curr_char_to_token_and_advance(tok);
-              mBufferedTokens.push_back(preprocessor_token(tok, PPTOK_PREPROCESSING_OP_OR_PUNC));
-            }
-
-            //Consume and output the ::
-            tok = "";
-            append_chars_to_token_and_advance(tok, 2);
-            mBufferedTokens.push_back(preprocessor_token(tok, PPTOK_PREPROCESSING_OP_OR_PUNC));
-          }
-
-          break;
-
-        }
-        else if(curr_char() == '%'
-                || curr_char() == '=')
-          append_curr_char_to_token_and_advance(tok);
-        else if(curr_char() == '<')
-        {
-          append_curr_char_to_token_and_advance(tok);
-
-          if(curr_char() == '=')
-            append_curr_char_to_token_and_advance(tok);
-        }
-
-        mBufferedTokens.push_back(preprocessor_token(tok, PPTOK_PREPROCESSING_OP_OR_PUNC));
-        break;
-      }
-
-      case '>':
-      {
-        string tok;
-        append_curr_char_to_token_and_advance(tok);
-
-        //May have >, >>, >>=, or >=
-        if(curr_char() == '>')
-        {
-          append_curr_char_to_token_and_advance(tok);
-
-          if(curr_char() == '=')
-            append_curr_char_to_token_and_advance(tok);
-        }
-        else if(curr_char() == '=')
-          append_curr_char_to_token_and_advance(tok);
-
-        mBufferedTokens.push_back(preprocessor_token(tok, PPTOK_PREPROCESSING_OP_OR_PUNC));
-        break;
-      }
-
-      case '%':
-      {
-        string tok;
-        append_curr_char_to_token_and_advance(tok);
-
-        if(curr_char() == ':')
-        {
-          append_curr_char_to_token_and_advance(tok);
-
-          if(curr_char() == '%'
-              && peek_char() == ':')
-            append_chars_to_token_and_advance(tok, 2);
-          else if(header_name_allowed)
-          {
-            mBufferedTokens.push_back(preprocessor_token(tok, PPTOK_PREPROCESSING_OP_OR_PUNC));
-            maybe_lex_header_name();
-            break;
-          }
-        }
-        else if(curr_char() == '>'
-                || curr_char() == '=')
-          append_curr_char_to_token_and_advance(tok);
-
-        mBufferedTokens.push_back(preprocessor_token(tok, PPTOK_PREPROCESSING_OP_OR_PUNC));
-        break;
-      }
-
-      case ':':
-      {
-        string tok;
-        append_curr_char_to_token_and_advance(tok);
-
-        if(curr_char() == '>'
-            || curr_char() == ':')
-          append_curr_char_to_token_and_advance(tok);
+    next_char();
+    emit_token(preprocessor_token(PUNC_LT));
+    return;
+  }
 
-        mBufferedTokens.push_back(preprocessor_token(tok, PPTOK_PREPROCESSING_OP_OR_PUNC));
-        break;
-      }
+  unsigned int state = punctuator_transition(0, curr_ch);
+  next_char();
 
-      case '|':
-      case '&':
-      {
-        //Maybe a op, op op,  or op=
-        string tok;
-        append_curr_char_to_token_and_advance(tok);
+  while(true)
+  {
+    unsigned int next_state = punctuator_transition(state, curr_char());
 
-        if(curr_char() == curr_ch
-            || curr_char() == '=')
-          append_curr_char_to_token_and_advance(tok);
+    if(!next_state)
+      break;
 
-        mBufferedTokens.push_back(preprocessor_token(tok, PPTOK_PREPROCESSING_OP_OR_PUNC));
-        break;
-      }
+    if(punctuator_accepted(next_state) == PUNC_NONE)
+    {
+      //.. and %:% aren't punctuators, so only continue if the character after them
+      //completes one
+      unsigned int final_state = punctuator_transition(next_state, peek_char());
 
-      case '{':
-      case '}':
-      case '[':
-      case ']':
-      case '(':
-      case ')':
-      case ';':
-      case '?':
-      case '~':
-      case ',':
-      {
-        string tok;
-        append_curr_char_to_token_and_advance(tok);
-        mBufferedTokens.push_back(preprocessor_token(tok, PPTOK_PREPROCESSING_OP_OR_PUNC));
+      if(punctuator_accepted(final_state) == PUNC_NONE)
         break;
-      }
-
-      case '^':
-      case '/':
-      case '*':
-      {
-        string tok;
-        append_curr_char_to_token_and_advance(tok);
-
-        //May have op or op=
-        if(curr_char() == '=')
-          append_curr_char_to_token_and_advance(tok);
 
-        mBufferedTokens.push_back(preprocessor_token(tok, PPTOK_PREPROCESSING_OP_OR_PUNC));
-        break;
-      }
+      skip_chars(2);
+      state = final_state;
+    }
+    else
+    {
+      next_char();
+      state = next_state;
+    }
+  }
 
-      case '+':
-      {
-        string tok;
-        append_curr_char_to_token_and_advance(tok);
+  preprocessor_punctuator punc = punctuator_accepted(state);
+  emit_token(preprocessor_token(punc));
 
-        //May have +, ++ or +=
-        if(curr_char() == '+'
-            || curr_char() == '=')
-          append_curr_char_to_token_and_advance(tok);
+  if(header_name_allowed
+     && (punc == PUNC_HASH || punc == PUNC_DIGRAPH_HASH))
+    maybe_lex_header_name();
+}
 
-         mBufferedTokens.push_back(preprocessor_token(tok, PPTOK_PREPROCESSING_OP_OR_PUNC));
-         break;
-      }
+/**
+* Scans the next token or sequence of tokens.
+*/
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::scan_next_token()
+{
+  if(!end_of_buffer())
+  {
+    bool header_name_allowed = mLastChar == -1 || mLastChar == '\n';
+    int curr_ch = curr_char();
+    mLastChar = curr_ch;
 
-      case '-':
+    switch(classify_char(curr_ch))
+    {
+      case CHCLASS_PUNCTUATOR:
       {
-        string tok;
-        append_curr_char_to_token_and_advance(tok);
-
-        //May have -, --, -=, -> or ->*
-        if(curr_char() == '-'
-            || curr_char() == '=')
-          append_curr_char_to_token_and_advance(tok);
-        else if(curr_char() == '>')
-        {
-          append_curr_char_to_token_and_advance(tok);
-
-          if(curr_char() == '*')
-            append_curr_char_to_token_and_advance(tok);
-        }
-
-        mBufferedTokens.push_back(preprocessor_token(tok, PPTOK_PREPROCESSING_OP_OR_PUNC));
+        lex_punctuator(curr_ch, header_name_allowed);
         break;
       }
 
-      case ' ':
-      case '\t':
-      case '\v':
-      case '\f':
-      case '\r':
+      case CHCLASS_WHITESPACE:
       {
         skip_whitespace();
-        mBufferedTokens.push_back(preprocessor_token(PPTOK_WHITESPACE));
+        emit_token(preprocessor_token(PPTOK_WHITESPACE));
         break;
       }
 
-      case '\n':
+      case CHCLASS_NEW_LINE:
       {
         //Only want to skip over the new-line char
         ++mCurrPosition;
-        mBufferedTokens.push_back(preprocessor_token(PPTOK_NEW_LINE));
+        ensure_lookahead();
+
+        emit_token(preprocessor_token(PPTOK_NEW_LINE));
         break;
       }
 
-      case '\"':
+      case CHCLASS_STRING:
       {
-        string lit;
-
-        append_curr_char_to_token_and_advance(lit);
-        lex_string_literal_contents(lit);
+        begin_token();
+        lex_string_literal_contents(mSpelling);
 
-        if(lex_user_defined_string_literal_suffix(lit))
-          mBufferedTokens.push_back(preprocessor_token(lit, PPTOK_USER_DEF_STRING_LITERAL));
+        if(lex_user_defined_string_literal_suffix(mSpelling))
+          emit_token(end_token(PPTOK_USER_DEF_STRING_LITERAL));
         else
-          mBufferedTokens.push_back(preprocessor_token(lit, PPTOK_STRING_LITERAL));
+          emit_token(end_token(PPTOK_STRING_LITERAL));
 
         break;
       }
 
-      case '\'':
+      case CHCLASS_CHAR:
       {
-        mBufferedTokens.push_back(lex_char_literal(/*wide_literal=*/false));
+        emit_token(lex_char_literal(/*wide_literal=*/false));
         break;
       }
-	  
-      case 'R':
+
+      case CHCLASS_RAW_PREFIX:
       {
         if(peek_char() == '\"')
         {
           //Raw string
-          string lit;
-
-          append_chars_to_token_and_advance(lit, 2);
-          lex_raw_string_literal_contents(lit);
+          begin_token();
+          append_curr_char_to_token_and_advance(mSpelling);
+          lex_raw_string_literal_contents(mSpelling);
 
-          mBufferedTokens.push_back(preprocessor_token(lit, PPTOK_STRING_LITERAL));
+          emit_token(end_token(PPTOK_STRING_LITERAL));
         }
         else
-        {   
-          //TODO: this looks wrong
-          string identifier;
-          mBufferedTokens.push_back(preprocessor_token(identifier, PPTOK_IDENTIFIER));
-        }
+          emit_token(lex_identifier());
 
         break;
       }
 
-      case 'U':
-      case 'u':
-      case 'L':
+      case CHCLASS_ENCODING_PREFIX:
       {
         if(peek_char() == '\'')
         {
-          mBufferedTokens.push_back(lex_char_literal(/*wide_literal=*/true));
+          emit_token(lex_char_literal(/*wide_literal=*/true));
           break;
         }
         else if(start_of_encoding_prefix())
         {
-          string prefix = "";
+          string &prefix = mSpelling;
+
+          begin_token();
           lex_encoding_prefix(prefix);
 
           //Add the opening " and the string contents
-          append_curr_char_to_token_and_advance(prefix);
-
-          if(prefix[prefix.length() - 2] == 'R')
+          if(prefix[prefix.length() - 1] == 'R')
             lex_raw_string_literal_contents(prefix);
           else
             lex_string_literal_contents(prefix);
 
           if(lex_user_defined_string_literal_suffix(prefix))
-            mBufferedTokens.push_back(preprocessor_token(prefix, PPTOK_USER_DEF_STRING_LITERAL));
+            emit_token(end_token(PPTOK_USER_DEF_STRING_LITERAL));
           else
-            mBufferedTokens.push_back(preprocessor_token(prefix, PPTOK_STRING_LITERAL));
+            emit_token(end_token(PPTOK_STRING_LITERAL));
 
           break;
         }
@@ -1443,97 +1551,38 @@ void preprocessor_lexer::scan_next_token()
         //Fallthru and treat the U, u, L or R as an identifier
       }
 
-      case 'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'g': case 'h': case 'i':
-      case 'j': case 'k': case 'l': case 'm': case 'n': case 'o': case 'p': case 'q': case 'r':
-      case 's': case 't': case 'v': case 'w': case 'x': case 'y': case 'z':
-      case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G': case 'H': case 'I':
-      case 'J': case 'K': case 'M': case 'N': case 'O': case 'P': case 'Q':
-      case 'S': case 'T': case 'V': case 'W': case 'X': case 'Y': case 'Z': case '_':
+      case CHCLASS_IDENTIFIER:
       {
-        mBufferedTokens.push_back(lex_identifier());
+        emit_token(lex_identifier());
         break;
       }
 
-      case '.':
+      case CHCLASS_DOT:
       {
-        if(nth_char(1) == '.'
-            && nth_char(2) == '.')
+        //A . which isn't followed by a digit is the start of ., .* or ...
+        if(!isdigit(peek_char()))
         {
-          //We have ...
-          string tok;
-
-          append_chars_to_token_and_advance(tok, 3);
-          mBufferedTokens.push_back(preprocessor_token(tok, PPTOK_PREPROCESSING_OP_OR_PUNC));
+          lex_punctuator(curr_ch, header_name_allowed);
           break;
         }
 
-        //Fallthru for single '.' case
-      }
-
-      case '0':
-      case '1':
-      case '2':
-      case '3':
-      case '4':
-      case '5':
-      case '6':
-      case '7':
-      case '8':
-      case '9':
-      {
-        int peeked_ch = peek_char();
-        string tok;
-
-        if(curr_ch == '.'
-            && !isdigit(peeked_ch))
-        {
-          append_curr_char_to_token_and_advance(tok);
-
-          if(curr_char() == '*')
-            append_curr_char_to_token_and_advance(tok);
-
-          mBufferedTokens.push_back(preprocessor_token(tok, PPTOK_PREPROCESSING_OP_OR_PUNC));
-        }
-        else
-        {
-          string num;
-          append_curr_char_to_token_and_advance(num);
-
-          preprocessor_token num_tok(num, PPTOK_NUMBER);
-          lex_pp_number(num_tok.data);
-          mBufferedTokens.push_back(num_tok);
-        }
-
-        break;
-      }
-
-      case '!':
-      {
-        string tok;
-        append_curr_char_to_token_and_advance(tok);
-
-        if(curr_char() == '=')
-          append_curr_char_to_token_and_advance(tok);
-
-        mBufferedTokens.push_back(preprocessor_token(tok, PPTOK_PREPROCESSING_OP_OR_PUNC));
-        break;
+        //Fallthru for the start of a pp-number
       }
 
-      case '=':
+      case CHCLASS_DIGIT:
       {
-        string tok;
-        append_curr_char_to_token_and_advance(tok);
-
-        if(curr_char() == '=')
-          append_curr_char_to_token_and_advance(tok);
+        begin_token();
+        append_curr_char_to_token_and_advance(mSpelling);
+        lex_pp_number(mSpelling);
 
-        mBufferedTokens.push_back(preprocessor_token(tok, PPTOK_PREPROCESSING_OP_OR_PUNC));
+        emit_token(end_token(PPTOK_NUMBER));
         break;
       }
 
-      case '\\':
+      case CHCLASS_BACKSLASH:
       {
         //Consume the '\'
+        begin_token();
         next_char();
 
         //If the next character is a new-line, consume the newline and carry on with the next character
@@ -1543,9 +1592,8 @@ void preprocessor_lexer::scan_next_token()
         else
         {
           //Treat it as a non-whitespace char
-          string non_ws_char;
-          non_ws_char.append(1, curr_ch);
-          mBufferedTokens.push_back(preprocessor_token(non_ws_char, PPTOK_NON_WHITESPACE_CHAR));
+          mSpelling.append(1, curr_ch);
+          emit_token(end_token(PPTOK_NON_WHITESPACE_CHAR));
         }
 
         break;
@@ -1553,58 +1601,168 @@ void preprocessor_lexer::scan_next_token()
 
       default:
 
-        string tok;
+        begin_token();
 
-        if(curr_ch >= 0
-            && curr_ch <= 127)
-          append_char_to_token(curr_ch, tok);
+        if(InputTraits::ascii_only
+           || (curr_ch >= 0 && curr_ch <= 127))
+          append_char_to_token(curr_ch, mSpelling);
         else
         {
           //UCNs may start an identifier.
-          if(valid_identifier_char(curr_ch)
-              && valid_initial_identifier_char(curr_ch))
+          if(identifier_char(curr_ch)
+              && initial_identifier_char(curr_ch))
           {
-            mBufferedTokens.push_back(lex_identifier());
+            emit_token(lex_identifier());
             break;
           }
           else
-            append_char_to_token(curr_ch, tok);
+            append_char_to_token(curr_ch, mSpelling);
         }
 
-        mBufferedTokens.push_back(preprocessor_token(tok, PPTOK_NON_WHITESPACE_CHAR));
-
         if(!end_of_buffer())
           next_char();
+
+        if(curr_ch == invalid_code_point)
+          mTokenInvalid = true;
+
+        emit_token(end_token(PPTOK_NON_WHITESPACE_CHAR));
     }
   }
   else if(!mEndOfFileTokensProcessed)
 	{
     //If the input is not empty and does not end in a new-line, insert one
-    if(mBuffer.length() > 0
+    if(mHaveInput
        && mLastChar != '\n')
-      mBufferedTokens.push_back(preprocessor_token(PPTOK_NEW_LINE));
+      emit_token(preprocessor_token(PPTOK_NEW_LINE));
 
-    mBufferedTokens.push_back(preprocessor_token(PPTOK_EOF));
+    emit_token(preprocessor_token(PPTOK_EOF));
     mEndOfFileTokensProcessed = true;
 	}
 }
 
-preprocessor_token preprocessor_lexer::next_token()
+/**
+ * Finishes the token started by begin_token, which ends before the current character.
+ * When the spelling is identical to the input it was lexed from the token refers to the
+ * input, otherwise the spelling is copied to the spelling arena. Transformations other
+ * than UTF-8 decoding always shorten the spelling, so the comparison is only needed when
+ * the lengths match. If an error was recovered from within the token it is PPTOK_INVALID
+ * instead of the specified type.
+ */
+template<typename InputTraits>
+preprocessor_token basic_preprocessor_lexer<InputTraits>::end_token(preprocessor_token_type type)
 {
-  scan_next_token();
+  preprocessor_token tok(mTokenInvalid ? PPTOK_INVALID : type);
+  mTokenInvalid = false;
+
+  size_t raw_length = char_offset() - mTokenStart;
+
+  if(!streaming()
+     && mSpelling.length() == raw_length
+     && (InputTraits::ascii_only
+         || memcmp(mSpelling.data(), mBufferStart + mTokenStart, raw_length) == 0))
+  {
+    tok.offset = mTokenStart;
+    tok.length = raw_length;
+  }
+  else
+  {
+    tok.flags |= PPTOKFLAG_SPELLING_IN_ARENA;
+    tok.offset = mSpellingArena.length();
+    tok.length = mSpelling.length();
+    mSpellingArena.append(mSpelling.data(), mSpelling.length());
+  }
+
+  return tok;
+}
 
-  preprocessor_token tok = mBufferedTokens.front();
-  mBufferedTokens.pop_front();
+template<typename InputTraits>
+preprocessor_token basic_preprocessor_lexer<InputTraits>::next_token()
+{
+  preprocessor_token tok;
+  next_tokens(&tok, 1);
 
   return tok;
- }
- 
-bool preprocessor_lexer::finished_tokenising()
+}
+
+/**
+ * Lexes up to max_tokens tokens directly into the specified array, returning the number
+ * produced. Fewer are only produced once the end of the input has been reached, after
+ * which 0 is returned. If an error is thrown, the tokens already lexed into the array by
+ * that call are lost.
+ */
+template<typename InputTraits>
+size_t basic_preprocessor_lexer<InputTraits>::next_tokens(preprocessor_token *tokens, size_t max_tokens)
+{
+  //When streaming, the spellings of the tokens already returned aren't kept
+  if(streaming()
+     && mBufferedTokens.empty())
+    mSpellingArena.clear();
+
+  return fill_tokens(tokens, max_tokens);
+}
+
+/**
+ * Lexes up to max_tokens tokens into the specified array as next_tokens does, but keeps
+ * the spellings of every token lexed so far.
+ */
+template<typename InputTraits>
+size_t basic_preprocessor_lexer<InputTraits>::fill_tokens(preprocessor_token *tokens, size_t max_tokens)
+{
+  size_t num_tokens = 0;
+
+  while(num_tokens < max_tokens)
+  {
+    //Scanning a line splice doesn't produce a token
+    if(mBufferedTokens.empty())
+    {
+      if(mEndOfFileTokensProcessed)
+        break;
+
+      scan_next_token();
+    }
+
+    for(; !mBufferedTokens.empty() && num_tokens < max_tokens; mBufferedTokens.pop_front())
+      tokens[num_tokens++] = mBufferedTokens.front();
+  }
+
+  return num_tokens;
+}
+
+template<typename InputTraits>
+bool basic_preprocessor_lexer<InputTraits>::finished_tokenising()
 {
   if(!mBufferedTokens.empty())
     return false;
 
-  return mCurrPosition == mBufferEnd
-         && mTransformedChars.empty()
+  return end_of_buffer()
          && mEndOfFileTokensProcessed;
 }
+
+/**
+ * Tokenises the whole of the remaining input into the specified token buffer, replacing
+ * its contents. The buffer takes over the spelling arena, so its spellings remain valid
+ * for the lifetime of the input even when streaming, and those which are spans of the
+ * input aren't available at all when streaming.
+ */
+template<typename InputTraits>
+void basic_preprocessor_lexer<InputTraits>::tokenise(token_buffer &tokens)
+{
+  preprocessor_token batch[token_batch_size];
+
+  tokens.clear();
+
+  //Growing the arrays copies every token lexed so far, so enough room for typical source
+  //is made up front. The size of a stream isn't known.
+  if(!streaming())
+    tokens.reserve((mBufferEnd - mCurrPosition) / bytes_per_token_estimate + 1);
+
+  while(size_t num_tokens = fill_tokens(batch, token_batch_size))
+    tokens.append(batch, num_tokens);
+
+  tokens.set_spellings(streaming() ? nullptr : mBufferStart, std::move(mSpellingArena));
+  mSpellingArena.clear();
+}
+
+//The lexer is only ever used with these input traits
+template class basic_preprocessor_lexer<utf8_input_traits>;
+template class basic_preprocessor_lexer<ascii_input_traits>;
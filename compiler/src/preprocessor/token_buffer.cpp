@@ -0,0 +1,186 @@
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+using namespace std;
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TOKEN_BUFFER_X86
+#endif
+
+#include "preprocessor/token_buffer.h"
+
+/**
+ * Constructor. Allocates the arrays from the specified arena, normally the one for the
+ * translation unit being lexed, instead of the heap.
+ */
+token_buffer::token_buffer(arena &memory)
+  : mTypes(arena_allocator<preprocessor_token_type>(&memory)),
+    mFlags(arena_allocator<uint8_t>(&memory)),
+    mPunctuators(arena_allocator<preprocessor_punctuator>(&memory)),
+    mKeywords(arena_allocator<preprocessor_keyword>(&memory)),
+    mOffsets(arena_allocator<uint32_t>(&memory)),
+    mLengths(arena_allocator<uint32_t>(&memory)),
+    mSymbols(arena_allocator<symbol_id>(&memory)),
+    mInput(nullptr),
+    mSpellingArena(arena_allocator<char>(&memory))
+{
+}
+
+/**
+ * Reassembles the token at the specified index.
+ */
+preprocessor_token token_buffer::operator[](size_t index) const
+{
+  preprocessor_token tok(mTypes[index]);
+  tok.flags = mFlags[index];
+  tok.punctuator = mPunctuators[index];
+  tok.keyword = mKeywords[index];
+  tok.offset = mOffsets[index];
+  tok.length = mLengths[index];
+  tok.symbol = mSymbols[index];
+
+  return tok;
+}
+
+/**
+ * Returns the spelling of the token at the specified index, in the same way as
+ * basic_preprocessor_lexer::spelling. Spellings which are spans of the input remain
+ * valid for the lifetime of the input.
+ */
+token_spelling token_buffer::spelling(size_t index) const
+{
+  preprocessor_punctuator punc = mPunctuators[index];
+
+  if(punc != PUNC_NONE)
+    return { punctuator_spellings[punc], strlen(punctuator_spellings[punc]) };
+
+  if(mFlags[index] & PPTOKFLAG_SPELLING_IN_ARENA)
+    return { mSpellingArena.data() + mOffsets[index], mLengths[index] };
+
+  return { mInput + mOffsets[index], mLengths[index] };
+}
+
+void token_buffer::reserve(size_t num_tokens)
+{
+  mTypes.reserve(num_tokens);
+  mFlags.reserve(num_tokens);
+  mPunctuators.reserve(num_tokens);
+  mKeywords.reserve(num_tokens);
+  mOffsets.reserve(num_tokens);
+  mLengths.reserve(num_tokens);
+  mSymbols.reserve(num_tokens);
+}
+
+void token_buffer::push_back(const preprocessor_token &tok)
+{
+  mTypes.push_back(tok.type);
+  mFlags.push_back(tok.flags);
+  mPunctuators.push_back(tok.punctuator);
+  mKeywords.push_back(tok.keyword);
+  mOffsets.push_back(tok.offset);
+  mLengths.push_back(tok.length);
+  mSymbols.push_back(tok.symbol);
+}
+
+/**
+ * Appends a batch of tokens. Each array is grown once for the whole batch, and then the
+ * fields are scattered to them in a single pass.
+ */
+void token_buffer::append(const preprocessor_token *tokens, size_t count)
+{
+  size_t first = size();
+
+  mTypes.resize(first + count);
+  mFlags.resize(first + count);
+  mPunctuators.resize(first + count);
+  mKeywords.resize(first + count);
+  mOffsets.resize(first + count);
+  mLengths.resize(first + count);
+  mSymbols.resize(first + count);
+
+  preprocessor_token_type *types = mTypes.data() + first;
+  uint8_t *flags = mFlags.data() + first;
+  preprocessor_punctuator *punctuators = mPunctuators.data() + first;
+  preprocessor_keyword *keywords = mKeywords.data() + first;
+  uint32_t *offsets = mOffsets.data() + first;
+  uint32_t *lengths = mLengths.data() + first;
+  symbol_id *symbols = mSymbols.data() + first;
+
+  for(size_t i = 0; i < count; i++)
+  {
+    types[i] = tokens[i].type;
+    flags[i] = tokens[i].flags;
+    punctuators[i] = tokens[i].punctuator;
+    keywords[i] = tokens[i].keyword;
+    offsets[i] = tokens[i].offset;
+    lengths[i] = tokens[i].length;
+    symbols[i] = tokens[i].symbol;
+  }
+}
+
+void token_buffer::clear()
+{
+  mTypes.clear();
+  mFlags.clear();
+  mPunctuators.clear();
+  mKeywords.clear();
+  mOffsets.clear();
+  mLengths.clear();
+  mSymbols.clear();
+  mInput = nullptr;
+  mSpellingArena.clear();
+}
+
+/**
+ * Sets where the spellings of the tokens are found: the input the lexer read from, and
+ * the spelling arena it built for the tokens which aren't spans of the input.
+ */
+void token_buffer::set_spellings(const char *input, arena_string spellings)
+{
+  mInput = input;
+  mSpellingArena = std::move(spellings);
+}
+
+/**
+ * Appends the indices of every token whose type is in the specified mask, built with
+ * token_type_bit, to indices. Filters such as skipping whitespace and new-lines become a
+ * single pass over the type array, 16 types at a time.
+ */
+void token_buffer::select(unsigned int type_mask, arena_vector<uint32_t> &indices) const
+{
+  const preprocessor_token_type *types = mTypes.data();
+  size_t num_tokens = mTypes.size();
+  size_t i = 0;
+
+#ifdef TOKEN_BUFFER_X86
+  //Compare against whichever of the wanted and unwanted types are fewer
+  unsigned int all_types = (1u << (PPTOK_INVALID + 1)) - 1;
+  bool inverted = __builtin_popcount(type_mask & all_types) > __builtin_popcount(~type_mask & all_types);
+  unsigned int compare_mask = inverted ? ~type_mask & all_types : type_mask & all_types;
+
+  for(; i + 16 <= num_tokens; i += 16)
+  {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(types + i));
+    __m128i matches = _mm_setzero_si128();
+
+    for(unsigned int bits = compare_mask; bits; bits &= bits - 1)
+      matches = _mm_or_si128(matches, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(__builtin_ctz(bits))));
+
+    unsigned int selected = (unsigned int)_mm_movemask_epi8(matches);
+
+    if(inverted)
+      selected = ~selected & 0xffff;
+
+    for(; selected; selected &= selected - 1)
+      indices.push_back(i + __builtin_ctz(selected));
+  }
+#endif
+
+  for(; i < num_tokens; i++)
+  {
+    if(type_mask & token_type_bit(types[i]))
+      indices.push_back(i);
+  }
+}
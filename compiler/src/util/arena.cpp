@@ -0,0 +1,119 @@
+#include <new>
+#include <cstdint>
+using namespace std;
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "util/arena.h"
+
+const size_t arena::default_block_size;
+
+arena::arena(size_t block_size)
+  : mBlocks(nullptr), mCurr(nullptr), mEnd(nullptr), mBlockSize(block_size), mBytesAllocated(0)
+{
+}
+
+arena::~arena()
+{
+  release();
+}
+
+//Blocks at least this large are backed by transparent huge pages where the OS allows it.
+//Every page of a fresh block faults when it's first written, and with 4 KB pages those
+//faults cost more than filling a token buffer.
+const size_t huge_page_size = 2 * 1024 * 1024;
+
+/**
+ * Maps a block of at least the specified size, rounded up to whole pages, and links it
+ * into the list of blocks. Huge pages can only back 2 MB aligned ranges, so a large block
+ * is mapped with room to spare, and trimmed to a whole number of aligned huge pages.
+ */
+arena::block *arena::map_block(size_t size)
+{
+  size_t page_size = size >= huge_page_size ? huge_page_size : sysconf(_SC_PAGESIZE);
+  size = (size + page_size - 1) & ~(page_size - 1);
+
+  size_t mapped_size = page_size == huge_page_size ? size + huge_page_size : size;
+  void *addr = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if(addr == MAP_FAILED)
+    throw bad_alloc();
+
+  if(page_size == huge_page_size)
+  {
+    char *start = static_cast<char*>(addr);
+    char *aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(start) + huge_page_size - 1) & ~(uintptr_t)(huge_page_size - 1));
+    char *end = start + mapped_size;
+
+    if(aligned > start)
+      munmap(start, aligned - start);
+
+    if(aligned + size < end)
+      munmap(aligned + size, end - (aligned + size));
+
+    addr = aligned;
+
+#ifdef MADV_HUGEPAGE
+    madvise(addr, size, MADV_HUGEPAGE);
+#endif
+  }
+
+  block *mapped = static_cast<block*>(addr);
+  mapped->next = mBlocks;
+  mapped->size = size;
+  mBlocks = mapped;
+
+  return mapped;
+}
+
+/**
+ * Allocates when the current block doesn't have room. Allocations too large to share a
+ * block get a block of their own, leaving the current block to carry on being used;
+ * otherwise a new block replaces it.
+ */
+void *arena::allocate_slow(size_t size, size_t alignment)
+{
+  size_t needed = sizeof(block) + alignment + size;
+
+  if(needed < size)
+    throw bad_alloc();
+
+  bool own_block = needed > mBlockSize / 4;
+  char *start;
+
+  if(own_block)
+    start = reinterpret_cast<char*>(map_block(needed) + 1);
+  else
+  {
+    block *fresh = map_block(mBlockSize);
+    start = reinterpret_cast<char*>(fresh + 1);
+    mEnd = reinterpret_cast<char*>(fresh) + fresh->size;
+  }
+
+  uintptr_t aligned = (reinterpret_cast<uintptr_t>(start) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+  if(!own_block)
+    mCurr = reinterpret_cast<char*>(aligned + size);
+
+  mBytesAllocated += size;
+
+  return reinterpret_cast<void*>(aligned);
+}
+
+/**
+ * Returns every block to the OS. Everything allocated from the arena is freed at once.
+ */
+void arena::release()
+{
+  while(mBlocks)
+  {
+    block *next = mBlocks->next;
+    munmap(mBlocks, mBlocks->size);
+    mBlocks = next;
+  }
+
+  mCurr = nullptr;
+  mEnd = nullptr;
+  mBytesAllocated = 0;
+}
@@ -0,0 +1,385 @@
+#include <vector>
+#include <cstdint>
+#include <cstring>
+using namespace std;
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BYTE_SCAN_X86
+#endif
+
+#include "util/byte_scan.h"
+
+/**
+ * Determines whether a block contains any byte which could start a phase 1 or 2
+ * transformation: the ? of a trigraph, a \ starting a UCN or line splice, or the first
+ * byte of a multi-byte UTF-8 sequence.
+ */
+bool block_has_trigger_bytes_scalar(const unsigned char *block, size_t length)
+{
+  for(size_t i = 0; i < length; i++)
+  {
+    if(block[i] == '?'
+       || block[i] == '\\'
+       || block[i] >= 0x80)
+      return true;
+  }
+
+  return false;
+}
+
+#ifdef BYTE_SCAN_X86
+
+/**
+ * SSE2 version of block_has_trigger_bytes_scalar for a full block.
+ */
+bool block_has_trigger_bytes_sse2(const unsigned char *block)
+{
+  const __m128i question = _mm_set1_epi8('?');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  __m128i found = _mm_setzero_si128();
+
+  for(size_t i = 0; i < clean_block_size; i += 16)
+  {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+
+    //Bytes >= 0x80 already have their top bit set so can be ORed in directly
+    found = _mm_or_si128(found, bytes);
+    found = _mm_or_si128(found, _mm_cmpeq_epi8(bytes, question));
+    found = _mm_or_si128(found, _mm_cmpeq_epi8(bytes, backslash));
+  }
+
+  return _mm_movemask_epi8(found) != 0;
+}
+
+/**
+ * AVX2 version of block_has_trigger_bytes_scalar for a full block.
+ */
+__attribute__((target("avx2")))
+bool block_has_trigger_bytes_avx2(const unsigned char *block)
+{
+  const __m256i question = _mm256_set1_epi8('?');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+
+  __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+  __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+
+  __m256i found = _mm256_or_si256(lo, hi);
+  found = _mm256_or_si256(found, _mm256_cmpeq_epi8(lo, question));
+  found = _mm256_or_si256(found, _mm256_cmpeq_epi8(hi, question));
+  found = _mm256_or_si256(found, _mm256_cmpeq_epi8(lo, backslash));
+  found = _mm256_or_si256(found, _mm256_cmpeq_epi8(hi, backslash));
+
+  return _mm256_movemask_epi8(found) != 0;
+}
+
+#endif
+
+/**
+ * Classifies each 64 byte block of the input, setting its bit in clean_blocks if it
+ * contains no bytes which could start a phase 1 or 2 transformation. Characters within
+ * a clean block can be read directly, except for the start of comments.
+ */
+void find_clean_blocks(const char *data, size_t length, vector<uint64_t> &clean_blocks)
+{
+  const unsigned char *bytes = reinterpret_cast<const unsigned char*>(data);
+  size_t num_blocks = (length + clean_block_size - 1) / clean_block_size;
+
+  clean_blocks.assign((num_blocks + 63) / 64, 0);
+
+#ifdef BYTE_SCAN_X86
+  static const bool use_avx2 = __builtin_cpu_supports("avx2");
+  size_t num_full_blocks = length / clean_block_size;
+#endif
+
+  for(size_t block = 0; block < num_blocks; block++)
+  {
+    const unsigned char *start = bytes + block * clean_block_size;
+    bool dirty;
+
+#ifdef BYTE_SCAN_X86
+    if(block < num_full_blocks)
+      dirty = use_avx2 ? block_has_trigger_bytes_avx2(start) : block_has_trigger_bytes_sse2(start);
+    else
+#endif
+      dirty = block_has_trigger_bytes_scalar(start, min(clean_block_size, length - block * clean_block_size));
+
+    if(!dirty)
+      clean_blocks[block / 64] |= uint64_t(1) << (block % 64);
+  }
+}
+
+/**
+ * Determines whether the input contains any bytes >= 0x80.
+ */
+bool has_non_ascii_bytes(const char *data, size_t length)
+{
+  const unsigned char *bytes = reinterpret_cast<const unsigned char*>(data);
+  size_t i = 0;
+
+#ifdef BYTE_SCAN_X86
+  //Or together 64 bytes at a time and check the top bits
+  for(; i + 64 <= length; i += 64)
+  {
+    __m128i found = _mm_or_si128(_mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i)),
+                                              _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i + 16))),
+                                 _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i + 32)),
+                                              _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i + 48))));
+
+    if(_mm_movemask_epi8(found))
+      return true;
+  }
+#endif
+
+  for(; i < length; i++)
+  {
+    if(bytes[i] >= 0x80)
+      return true;
+  }
+
+  return false;
+}
+
+/**
+ * Skips any backslash-newline sequences starting at pos.
+ */
+const char *skip_line_splices(const char *pos, const char *end)
+{
+  while(pos < end && *pos == '\\')
+  {
+    const char *next = pos + 1;
+
+    if(next < end && *next == '\r')
+      next++;
+
+    if(next >= end || *next != '\n')
+      break;
+
+    pos = next + 1;
+  }
+
+  return pos;
+}
+
+/**
+ * Determines whether the input consists only of 7-bit ASCII characters with no trigraphs
+ * or universal-character-names, so that no character of it can lie outside the basic
+ * source character set once translation phases 1-3 have been applied.
+ */
+bool is_ascii_source(const char *data, size_t length)
+{
+  if(has_non_ascii_bytes(data, length))
+    return false;
+
+  const char *end = data + length;
+
+  //Look for ??x trigraphs
+  for(const char *pos = data; (pos = static_cast<const char*>(memchr(pos, '?', end - pos))) != nullptr; pos++)
+  {
+    const char *second = skip_line_splices(pos + 1, end);
+
+    if(second >= end)
+      break;
+
+    const char *third = skip_line_splices(second + 1, end);
+
+    if(third < end
+       && *second == '?'
+       && *third != '\0'
+       && strchr("=/'()!<>-", *third) != nullptr)
+      return false;
+  }
+
+  //Look for \u and \U
+  for(const char *pos = data; (pos = static_cast<const char*>(memchr(pos, '\\', end - pos))) != nullptr; pos++)
+  {
+    const char *next = skip_line_splices(pos + 1, end);
+
+    if(next < end
+       && (*next == 'u' || *next == 'U'))
+      return false;
+  }
+
+  return true;
+}
+
+/*
+ * Determines whether the byte is a nondigit or digit from the basic source character set.
+ */
+inline bool is_identifier_byte(unsigned char byte)
+{
+  unsigned char folded = byte | 0x20;
+
+  return (folded >= 'a' && folded <= 'z')
+         || (byte >= '0' && byte <= '9')
+         || byte == '_';
+}
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+/*
+ * Replicates the byte across each byte of a 64 bit word.
+ */
+inline uint64_t repeat_byte(unsigned char byte)
+{
+  return 0x0101010101010101ULL * byte;
+}
+
+/*
+ * Sets the top bit of each byte of the word which lies in [low, high]. The bytes must
+ * all be below 0x80 so that no carries cross between them.
+ */
+inline uint64_t swar_bytes_in_range(uint64_t word, unsigned char low, unsigned char high)
+{
+  return (word + repeat_byte(0x80 - low)) & ~(word + repeat_byte(0x7F - high)) & repeat_byte(0x80);
+}
+
+/*
+ * Sets the top bit of each byte of the word which isn't a nondigit or digit from the
+ * basic source character set.
+ */
+inline uint64_t swar_non_identifier_bytes(uint64_t word)
+{
+  uint64_t high_bits = word & repeat_byte(0x80);
+  uint64_t low_bits = word & repeat_byte(0x7F);
+
+  uint64_t identifier = swar_bytes_in_range(low_bits | repeat_byte(0x20), 'a', 'z')
+                        | swar_bytes_in_range(low_bits, '0', '9')
+                        | swar_bytes_in_range(low_bits, '_', '_');
+
+  return (~identifier | high_bits) & repeat_byte(0x80);
+}
+
+#endif
+
+/**
+ * Returns the length of the run of nondigits and digits from the basic source character
+ * set at the start of the input. None of these bytes can start a phase 1 or 2
+ * transformation, so the run is part of the same identifier however it's lexed.
+ */
+size_t identifier_run_length(const char *data, size_t length)
+{
+  const unsigned char *bytes = reinterpret_cast<const unsigned char*>(data);
+  size_t i = 0;
+
+#ifdef BYTE_SCAN_X86
+  //Check 16 bytes at a time. Bytes >= 0x80 compare as negative so are outside every range.
+  const __m128i case_bit = _mm_set1_epi8(0x20);
+
+  for(; i + 16 <= length; i += 16)
+  {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i));
+    __m128i folded = _mm_or_si128(chunk, case_bit);
+
+    __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(folded, _mm_set1_epi8('a' - 1)),
+                                    _mm_cmplt_epi8(folded, _mm_set1_epi8('z' + 1)));
+    __m128i digits = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('0' - 1)),
+                                   _mm_cmplt_epi8(chunk, _mm_set1_epi8('9' + 1)));
+    __m128i underscores = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_'));
+
+    unsigned int mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letters, digits), underscores));
+
+    if(mask != 0xFFFF)
+      return i + __builtin_ctz(~mask);
+  }
+#endif
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  //Then 8 bytes at a time within a word
+  for(; i + 8 <= length; i += 8)
+  {
+    uint64_t word;
+    memcpy(&word, bytes + i, sizeof(word));
+
+    uint64_t stop = swar_non_identifier_bytes(word);
+
+    if(stop)
+      return i + __builtin_ctzll(stop) / 8;
+  }
+#endif
+
+  while(i < length && is_identifier_byte(bytes[i]))
+    i++;
+
+  return i;
+}
+
+/**
+ * Returns the length of the run of horizontal whitespace (space, tab, vertical tab, form
+ * feed and carriage return) at the start of the input. None of these bytes can start a
+ * phase 1 or 2 transformation or a comment.
+ */
+size_t whitespace_run_length(const char *data, size_t length)
+{
+  size_t i = 0;
+
+#ifdef BYTE_SCAN_X86
+  //Check 16 bytes at a time. Tab, vertical tab, form feed and carriage return are 9, 11,
+  //12 and 13, so together with new-line (10) they form one range which excludes it again.
+  for(; i + 16 <= length; i += 16)
+  {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+
+    __m128i controls = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('\t' - 1)),
+                                     _mm_cmplt_epi8(chunk, _mm_set1_epi8('\r' + 1)));
+    __m128i whitespace = _mm_or_si128(_mm_andnot_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')), controls),
+                                      _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')));
+
+    unsigned int mask = _mm_movemask_epi8(whitespace);
+
+    if(mask != 0xFFFF)
+      return i + __builtin_ctz(~mask);
+  }
+#endif
+
+  while(i < length
+        && (data[i] == ' '
+            || data[i] == '\t'
+            || data[i] == '\v'
+            || data[i] == '\f'
+            || data[i] == '\r'))
+    i++;
+
+  return i;
+}
+
+/**
+ * Returns the length of the run of bytes at the start of the input which can be copied
+ * straight into the body of a string or character literal: anything other than the
+ * closing quote, a \ starting an escape sequence, UCN or line splice, the ? of a
+ * trigraph or the first byte of a multi-byte UTF-8 sequence.
+ */
+size_t literal_run_length(const char *data, size_t length, char quote)
+{
+  const unsigned char *bytes = reinterpret_cast<const unsigned char*>(data);
+  size_t i = 0;
+
+#ifdef BYTE_SCAN_X86
+  //Check 16 bytes at a time. Bytes >= 0x80 already have their top bit set.
+  const __m128i quotes = _mm_set1_epi8(quote);
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i question = _mm_set1_epi8('?');
+
+  for(; i + 16 <= length; i += 16)
+  {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i));
+
+    __m128i stop = _mm_or_si128(_mm_or_si128(chunk, _mm_cmpeq_epi8(chunk, quotes)),
+                                _mm_or_si128(_mm_cmpeq_epi8(chunk, backslash), _mm_cmpeq_epi8(chunk, question)));
+
+    unsigned int mask = _mm_movemask_epi8(stop);
+
+    if(mask)
+      return i + __builtin_ctz(mask);
+  }
+#endif
+
+  while(i < length
+        && bytes[i] != (unsigned char)quote
+        && bytes[i] != '\\'
+        && bytes[i] != '?'
+        && bytes[i] < 0x80)
+    i++;
+
+  return i;
+}
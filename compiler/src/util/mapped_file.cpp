@@ -0,0 +1,109 @@
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+using namespace std;
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "util/mapped_file.h"
+
+/**
+ * Reads everything remaining in the file descriptor, which may be a pipe or terminal and
+ * so have no known size. Throws a runtime_error naming the file if it can't be read.
+ */
+string read_file_descriptor(int fd, const string &name)
+{
+  string contents;
+  char chunk[64 * 1024];
+  ssize_t bytes_read;
+
+  while((bytes_read = read(fd, chunk, sizeof(chunk))) != 0)
+  {
+    if(bytes_read < 0)
+    {
+      if(errno == EINTR)
+        continue;
+
+      throw runtime_error("Unable to read " + name + ": " + strerror(errno));
+    }
+
+    contents.append(chunk, bytes_read);
+  }
+
+  return contents;
+}
+
+/**
+ * Maps the specified file into memory, or reads it if it isn't a regular file. Throws a
+ * runtime_error if the file can't be opened, mapped or read.
+ */
+mapped_file::mapped_file(const string &path) : mData(nullptr), mSize(0)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+
+  if(fd == -1)
+    throw runtime_error("Unable to open " + path + ": " + strerror(errno));
+
+  struct stat st;
+
+  if(fstat(fd, &st) == -1)
+  {
+    int err = errno;
+    close(fd);
+    throw runtime_error("Unable to stat " + path + ": " + strerror(err));
+  }
+
+  //The size of a pipe, terminal or the like is meaningless, usually 0
+  if(!S_ISREG(st.st_mode))
+  {
+    try
+    {
+      mContents = read_file_descriptor(fd, path);
+    }
+    catch(...)
+    {
+      close(fd);
+      throw;
+    }
+
+    close(fd);
+    mData = mContents.data();
+    mSize = mContents.length();
+    return;
+  }
+
+  mSize = st.st_size;
+
+  //mmap rejects zero length mappings so an empty file is left unmapped
+  if(mSize > 0)
+  {
+    void *addr = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if(addr == MAP_FAILED)
+    {
+      int err = errno;
+      close(fd);
+      throw runtime_error("Unable to map " + path + ": " + strerror(err));
+    }
+
+    //The lexer reads the input front to back
+    madvise(addr, mSize, MADV_SEQUENTIAL);
+    mData = static_cast<const char*>(addr);
+  }
+
+  //The mapping remains valid after the descriptor is closed
+  close(fd);
+}
+
+/**
+ * Unmaps the file, unless it was read instead.
+ */
+mapped_file::~mapped_file()
+{
+  if(mData
+     && mData != mContents.data())
+    munmap(const_cast<char*>(mData), mSize);
+}
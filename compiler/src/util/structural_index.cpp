@@ -0,0 +1,161 @@
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+using namespace std;
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STRUCTURAL_INDEX_X86
+#endif
+
+#include "util/structural_index.h"
+
+/**
+ * Classifies the 64 bytes of a block, setting the corresponding bit of each mask.
+ */
+void classify_block(const unsigned char *block, uint64_t *masks)
+{
+  for(int kind = 0; kind < SI_NUM_KINDS; kind++)
+    masks[kind] = 0;
+
+#ifdef STRUCTURAL_INDEX_X86
+  for(int i = 0; i < 64; i += 16)
+  {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+    __m128i folded = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+
+    //Bytes >= 0x80 compare as negative so are outside every range
+    __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(folded, _mm_set1_epi8('a' - 1)),
+                                    _mm_cmplt_epi8(folded, _mm_set1_epi8('z' + 1)));
+    __m128i digits = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('0' - 1)),
+                                   _mm_cmplt_epi8(chunk, _mm_set1_epi8('9' + 1)));
+    __m128i identifier = _mm_or_si128(_mm_or_si128(letters, digits), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_')));
+
+    __m128i new_line = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'));
+    __m128i controls = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('\t' - 1)),
+                                     _mm_cmplt_epi8(chunk, _mm_set1_epi8('\r' + 1)));
+    __m128i whitespace = _mm_or_si128(_mm_andnot_si128(new_line, controls),
+                                      _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')));
+
+    __m128i trigger = _mm_or_si128(chunk, _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('?')),
+                                                       _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'))));
+
+    masks[SI_IDENTIFIER] |= (uint64_t)(unsigned int)_mm_movemask_epi8(identifier) << i;
+    masks[SI_WHITESPACE] |= (uint64_t)(unsigned int)_mm_movemask_epi8(whitespace) << i;
+    masks[SI_TRIGGER] |= (uint64_t)(unsigned int)_mm_movemask_epi8(trigger) << i;
+    masks[SI_DOUBLE_QUOTE] |= (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"'))) << i;
+    masks[SI_SINGLE_QUOTE] |= (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\''))) << i;
+    masks[SI_STAR] |= (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('*'))) << i;
+    masks[SI_NEW_LINE] |= (uint64_t)(unsigned int)_mm_movemask_epi8(new_line) << i;
+  }
+#else
+  for(int i = 0; i < 64; i++)
+  {
+    unsigned char byte = block[i];
+    unsigned char folded = byte | 0x20;
+    uint64_t bit = uint64_t(1) << i;
+
+    if((folded >= 'a' && folded <= 'z') || (byte >= '0' && byte <= '9') || byte == '_')
+      masks[SI_IDENTIFIER] |= bit;
+
+    if(byte == ' ' || byte == '\t' || byte == '\v' || byte == '\f' || byte == '\r')
+      masks[SI_WHITESPACE] |= bit;
+
+    if(byte == '?' || byte == '\\' || byte >= 0x80)
+      masks[SI_TRIGGER] |= bit;
+
+    if(byte == '"')
+      masks[SI_DOUBLE_QUOTE] |= bit;
+    else if(byte == '\'')
+      masks[SI_SINGLE_QUOTE] |= bit;
+    else if(byte == '*')
+      masks[SI_STAR] |= bit;
+    else if(byte == '\n')
+      masks[SI_NEW_LINE] |= bit;
+  }
+#endif
+}
+
+/**
+ * Builds the index over the whole of the specified input. Any partial final block is
+ * copied into a zero padded block first; a 0 byte isn't of any kind.
+ */
+structural_index::structural_index(const char *data, size_t length) : mLength(length)
+{
+  const unsigned char *bytes = reinterpret_cast<const unsigned char*>(data);
+  size_t num_blocks = (length + 63) / 64;
+
+  mMasks.resize(num_blocks * SI_NUM_KINDS);
+
+  for(size_t block = 0; block < num_blocks; block++)
+  {
+    size_t offset = block * 64;
+
+    if(length - offset >= 64)
+      classify_block(bytes + offset, &mMasks[block * SI_NUM_KINDS]);
+    else
+    {
+      unsigned char tail[64] = {};
+      memcpy(tail, bytes + offset, length - offset);
+      classify_block(tail, &mMasks[block * SI_NUM_KINDS]);
+    }
+  }
+}
+
+/**
+ * Returns the offset of the first byte of the specified kind at or after the specified
+ * offset, or the length of the input if there isn't one.
+ */
+size_t structural_index::next(structural_kind kind, size_t offset) const
+{
+  return next_of(kind, kind, offset);
+}
+
+/**
+ * Returns the offset of the first byte of either of the specified kinds at or after the
+ * specified offset, or the length of the input if there isn't one.
+ */
+size_t structural_index::next_of(structural_kind first, structural_kind second, size_t offset) const
+{
+  if(offset >= mLength)
+    return mLength;
+
+  size_t num_blocks = mMasks.size() / SI_NUM_KINDS;
+  size_t block = offset / 64;
+  uint64_t bits = (mask(block, first) | mask(block, second)) & (~uint64_t(0) << (offset % 64));
+
+  while(!bits)
+  {
+    if(++block == num_blocks)
+      return mLength;
+
+    bits = mask(block, first) | mask(block, second);
+  }
+
+  return min(block * 64 + __builtin_ctzll(bits), mLength);
+}
+
+/**
+ * Returns the offset of the first byte which isn't of the specified kind at or after the
+ * specified offset, or the length of the input if there isn't one.
+ */
+size_t structural_index::next_not(structural_kind kind, size_t offset) const
+{
+  if(offset >= mLength)
+    return mLength;
+
+  size_t num_blocks = mMasks.size() / SI_NUM_KINDS;
+  size_t block = offset / 64;
+  uint64_t bits = ~mask(block, kind) & (~uint64_t(0) << (offset % 64));
+
+  while(!bits)
+  {
+    if(++block == num_blocks)
+      return mLength;
+
+    bits = ~mask(block, kind);
+  }
+
+  return min(block * 64 + __builtin_ctzll(bits), mLength);
+}
@@ -1,133 +1,293 @@
-#include <vector>
-#include <string>
+#include <cstddef>
+#include <cstdint>
 using namespace std;
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define UTF8_X86
+#endif
+
 #include "util/utf8.h"
 
+//Encoded in place of code points which are outside of the Unicode code space
+const unsigned int replacement_character = 0xFFFD;
+
+/**
+ * Returns the number of code units in the sequence introduced by the specified lead byte,
+ * or 0 if the byte can't start a sequence.
+ */
+size_t utf8_sequence_length(unsigned char lead)
+{
+  if(lead < 0x80)
+    return 1;
+  else if(lead < 0xC0)
+    return 0;
+  else if(lead <= 0xDF)
+    return 2;
+  else if(lead <= 0xEF)
+    return 3;
+  else if(lead <= 0xF7)
+    return 4;
+
+  return 0;
+}
+
 /**
- * Encodes the specified character number into UTF-8
+ * Encodes the specified code point into UTF-8, writing the code units to out which must
+ * have room for max_utf8_code_units. Returns the number of code units written.
  */
-int encode_to_utf8(unsigned int char_number)
+size_t encode_utf8(unsigned int code_point, char *out)
 {
-  unsigned char b1 = 0;
-  unsigned char b2 = 0;
-  unsigned char b3 = 0;
-  unsigned char b4 = 0;
-
-  if(char_number < 0x80)
-    return char_number & 0x7F;
-  else if(char_number < 0x0800)
+  if(code_point >= 0x110000)
+    code_point = replacement_character;
+
+  if(code_point < 0x80)
   {
-    b1 = (char_number >> 6 & 0x1F) | 0xC0;
-    b2 = (char_number & 0x3F) | 0x80;
+    out[0] = code_point;
+    return 1;
   }
-  else if(char_number < 0x010000)
+  else if(code_point < 0x0800)
   {
-    b1 = (char_number >> 12 & 0x0F) | 0xE0;
-    b2 = (char_number >> 6 & 0x3F) | 0x80;
-    b3 = (char_number & 0x3F) | 0x80;
+    out[0] = (code_point >> 6 & 0x1F) | 0xC0;
+    out[1] = (code_point & 0x3F) | 0x80;
+    return 2;
   }
-  else if(char_number < 0x110000)
+  else if(code_point < 0x010000)
   {
-    b1 = (char_number >> 18 & 0x07) | 0xF0;
-    b2 = (char_number >> 12 & 0x3F) | 0x80;
-    b3 = (char_number >> 6  & 0x3F) | 0x80;
-    b4 = (char_number & 0x3F) | 0x80;
+    out[0] = (code_point >> 12 & 0x0F) | 0xE0;
+    out[1] = (code_point >> 6 & 0x3F) | 0x80;
+    out[2] = (code_point & 0x3F) | 0x80;
+    return 3;
   }
 
-  return (b1 << 24) | (b2 << 16) | (b3 << 8) | b4;
+  out[0] = (code_point >> 18 & 0x07) | 0xF0;
+  out[1] = (code_point >> 12 & 0x3F) | 0x80;
+  out[2] = (code_point >> 6  & 0x3F) | 0x80;
+  out[3] = (code_point & 0x3F) | 0x80;
+  return 4;
+}
+
+/**
+ * Encodes the specified code point into UTF-8.
+ */
+utf8_code_units encode_utf8(unsigned int code_point)
+{
+  utf8_code_units code_units;
+  code_units.length = encode_utf8(code_point, code_units.data);
+  return code_units;
 }
 
 /**
- * Decodes a UTF8 encoded code point.
+ * Decodes a UTF-8 encoded code point from the specified code units. The sequence isn't
+ * validated, the payload bits of each code unit are simply combined.
  */
-int decode_from_utf8(vector<unsigned char> code_units)
+unsigned int decode_utf8(const char *code_units, size_t length)
 {
-  unsigned char b1 = 0;
-  unsigned char b2 = 0;
-  unsigned char b3 = 0;
-  unsigned char b4 = 0;
+  const unsigned char *units = reinterpret_cast<const unsigned char*>(code_units);
 
-  switch(code_units.size())
+  switch(length)
   {
+    case 1:
+      return units[0];
+
     case 2:
-    {
-      //A two byte UTF8 sequence is represented as 110xxxxx 10yyyyyy
-      //so mask out the bits represented by 110 and 10 to leave just
-      //the x/y bits set
-      b1 = code_units[0] & 0x3f;
-      b2 = code_units[1] & 0x7f;
-
-      //Combine the bits from b1 and b2 to form a 16-bit number with
-      //the bytes 00000xxx xxyyyyyy where the lower two x bits become the
-      //upper two bits of y.The value of this number is the unicode
-      //character name
-      unsigned char x = b1 >> 2;
-      unsigned char y = ((b1 & 0x3) << 6) | b2;
-
-      return x << 8 | y;
-    }
+      //110xxxxx 10yyyyyy
+      return (units[0] & 0x3F) << 6 | (units[1] & 0x3F);
 
     case 3:
-    {
-      //A three byte UTF8 character is represented as 
-      //1110xxxx 10yyyyyy 10zzzzzz so mask out the upper bits of
-      //each code units to leave the bits we want
-      b1 = code_units[0] & 0xF;
-      b2 = code_units[1] & 0x3F;
-      b3 = code_units[2] & 0x3F;
-
-      //Combine thhe bits from each byte to form a 16-bit number of 
-      //form xxxxyyyy yyzzzzzz whose value is the Unicode character name
-      unsigned char x = (b1 << 4) | ((b2 & 0x3C) >> 2);
-      unsigned char y = (b2 & 0x3) << 6 | b3;
-      return (x << 8) | y;
-    }
+      //1110xxxx 10yyyyyy 10zzzzzz
+      return (units[0] & 0x0F) << 12 | (units[1] & 0x3F) << 6 | (units[2] & 0x3F);
 
     case 4:
-    {
-      //A four byte UTF8 character is represented as
-      //11110www 10xxxxxx 10yyyyyy 10zzzzzz so mask out the upper bits
-      //of each code unit to leave the bits we're interested in.
-      b1 = code_units[0] & 0x3;
-      b2 = code_units[1] & 0x3F;
-      b3 = code_units[2] & 0x3F;
-      b4 = code_units[3] & 0x3F;
-
-      //Combine the bits from each byte to form a 24-bit number with the
-      //bytes 000wwwxx xxxxyyyy yyzzzzzz where the bits from x and y are
-      //shifted left to form each byte value
-      unsigned char x = b1 << 2 | ((b2 & 0x30) >> 4);
-      unsigned char y = (b2 & 0xF) << 4 | ((b3 & 0x3C) >> 2);
-      unsigned char z = (b3 & 0x3) << 6 | b4;
-      return (x << 16) | (y << 8) | z;
-    }
+      //11110www 10xxxxxx 10yyyyyy 10zzzzzz
+      return (units[0] & 0x07) << 18 | (units[1] & 0x3F) << 12 | (units[2] & 0x3F) << 6 | (units[3] & 0x3F);
 
     default:
       return 0;
+  }
+}
+
+/**
+ * Decodes a UTF-8 encoded code point.
+ */
+unsigned int decode_utf8(const utf8_code_units &code_units)
+{
+  return decode_utf8(code_units.data, code_units.length);
+}
+
+/**
+ * Returns the length of the well formed UTF-8 sequence at the start of the input as
+ * defined by table 3-7 of the Unicode standard, or 0 if it's ill-formed or truncated.
+ * Overlong encodings, surrogates and code points above U+10FFFF are all ill-formed.
+ */
+size_t well_formed_sequence_length(const unsigned char *units, size_t available)
+{
+  unsigned char lead = units[0];
+  size_t length = utf8_sequence_length(lead);
+
+  if(length == 0
+     || length > available)
+    return 0;
+
+  //The range allowed for the second code unit depends upon the lead byte
+  unsigned char low = 0x80;
+  unsigned char high = 0xBF;
+
+  if(lead < 0xC2 || lead > 0xF4)
+    return 0;
+  else if(lead == 0xE0)
+    low = 0xA0;
+  else if(lead == 0xED)
+    high = 0x9F;
+  else if(lead == 0xF0)
+    low = 0x90;
+  else if(lead == 0xF4)
+    high = 0x8F;
+
+  if(units[1] < low || units[1] > high)
+    return 0;
+
+  for(size_t i = 2; i < length; i++)
+  {
+    if((units[i] & 0xC0) != 0x80)
+      return 0;
+  }
+
+  return length;
+}
+
+#ifdef UTF8_X86
+
+/**
+ * Returns the number of bytes at the start of the input, in multiples of 16, which are all ASCII.
+ */
+size_t ascii_prefix_length(const unsigned char *data, size_t length)
+{
+  size_t i = 0;
 
+  for(; i + 16 <= length; i += 16)
+  {
+    if(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i))))
+      break;
+  }
+
+  return i;
+}
+
+/**
+ * Widens the ASCII bytes at the start of the input into UTF-32 code points 16 at a time.
+ * Returns the number of bytes converted.
+ */
+size_t widen_ascii_prefix(const unsigned char *data, size_t length, char32_t *out)
+{
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+
+  for(; i + 16 <= length; i += 16)
+  {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+
+    if(_mm_movemask_epi8(bytes))
+      break;
+
+    __m128i low_half = _mm_unpacklo_epi8(bytes, zero);
+    __m128i high_half = _mm_unpackhi_epi8(bytes, zero);
+    __m128i *dest = reinterpret_cast<__m128i*>(out + i);
+
+    _mm_storeu_si128(dest, _mm_unpacklo_epi16(low_half, zero));
+    _mm_storeu_si128(dest + 1, _mm_unpackhi_epi16(low_half, zero));
+    _mm_storeu_si128(dest + 2, _mm_unpacklo_epi16(high_half, zero));
+    _mm_storeu_si128(dest + 3, _mm_unpackhi_epi16(high_half, zero));
   }
 
-  return (b1 << 24) | (b2 << 16) | (b3 << 8) | b4;
+  return i;
+}
+
+#else
+
+size_t ascii_prefix_length(const unsigned char *data, size_t length)
+{
+  return 0;
+}
+
+size_t widen_ascii_prefix(const unsigned char *data, size_t length, char32_t *out)
+{
+  return 0;
 }
 
+#endif
+
 /**
- * Converts a UTF-8 encoded code unit into its equivalent code points.
+ * Validates that the input is well formed UTF-8. Returns the offset of the first code unit
+ * of the first ill-formed or truncated sequence, or utf8_no_error if the input is valid.
  */
-void utf8_code_point_to_code_units(int code_point, vector<unsigned char> &code_units)
+size_t validate_utf8(const char *data, size_t length)
 {
-  unsigned char b1 = ((unsigned int)code_point) >> 24;
-  unsigned char b2 = (((unsigned int)code_point) >> 16) & 0xFF;
-  unsigned char b3 = (((unsigned int)code_point) >> 8) & 0xFFFF;
-  unsigned char b4 = ((unsigned int)code_point) & 0xFFFFFF;
+  const unsigned char *units = reinterpret_cast<const unsigned char*>(data);
+  size_t i = 0;
+
+  while(i < length)
+  {
+    if(units[i] < 0x80)
+    {
+      //Runs of ASCII are checked a block at a time
+      i += ascii_prefix_length(units + i, length - i);
 
-  //Always have at least two code units
-  code_units.push_back(b1);
-  code_units.push_back(b2);
+      while(i < length && units[i] < 0x80)
+        i++;
 
-  if(b3)
-    code_units.push_back(b3);
+      continue;
+    }
+
+    size_t sequence_length = well_formed_sequence_length(units + i, length - i);
+
+    if(sequence_length == 0)
+      return i;
+
+    i += sequence_length;
+  }
+
+  return utf8_no_error;
+}
+
+/**
+ * Validates and decodes the input into UTF-32. out must have room for length code points.
+ * num_code_points is set to the number of code points written, which on an error are those
+ * decoded before it. Returns the offset of the first code unit of the first ill-formed or
+ * truncated sequence, or utf8_no_error if the whole input was decoded.
+ */
+size_t decode_utf8_to_utf32(const char *data, size_t length, char32_t *out, size_t &num_code_points)
+{
+  const unsigned char *units = reinterpret_cast<const unsigned char*>(data);
+  char32_t *out_start = out;
+  size_t i = 0;
+
+  while(i < length)
+  {
+    if(units[i] < 0x80)
+    {
+      size_t widened = widen_ascii_prefix(units + i, length - i, out);
+      i += widened;
+      out += widened;
+
+      while(i < length && units[i] < 0x80)
+        *out++ = units[i++];
+
+      continue;
+    }
+
+    size_t sequence_length = well_formed_sequence_length(units + i, length - i);
+
+    if(sequence_length == 0)
+    {
+      num_code_points = out - out_start;
+      return i;
+    }
+
+    *out++ = decode_utf8(data + i, sequence_length);
+    i += sequence_length;
+  }
 
-  if(b4)
-    code_units.push_back(b4);
+  num_code_points = out - out_start;
+  return utf8_no_error;
 }
@@ -1,33 +1,129 @@
-#include <iostream>
-#include <sstream>
+#include <fstream>
+#include <stdexcept>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <cerrno>
 using namespace std;
 
+#include <unistd.h>
+
 #include "preprocessor/preprocessor_lexer.h"
+#include "util/mapped_file.h"
+#include "util/byte_scan.h"
+
+//Number of tokens fetched from the lexer at a time
+const size_t token_batch_size = 256;
+
+/**
+ * Tokenises the entire input of the specified lexer, reporting any errors it recovered
+ * from. Returns the number of errors.
+ */
+template<typename Lexer>
+size_t tokenise(Lexer &tokeniser)
+{
+  preprocessor_token tokens[token_batch_size];
+
+  while(tokeniser.next_tokens(tokens, token_batch_size))
+    ;
+
+  for(const preprocessor_diagnostic &diagnostic : tokeniser.diagnostics())
+    fprintf(stderr, "ERROR: %s\n", diagnostic.message().c_str());
+
+  return tokeniser.diagnostics().size();
+}
 
-int main()
+/**
+ * Tokenises the given buffer, using the lexer specialised for ASCII input when the buffer
+ * cannot contain any characters outside the basic source character set.
+ */
+size_t tokenise(const char *input, size_t length, unsigned int flags)
+{
+  if(is_ascii_source(input, length))
+  {
+    ascii_preprocessor_lexer tokeniser(input, length, flags);
+    return tokenise(tokeniser);
+  }
+  else
+  {
+    preprocessor_lexer tokeniser(input, length, flags);
+    return tokenise(tokeniser);
+  }
+}
+
+/**
+ * Usage: posttoken [--stream] [--structural-index] [--recover] [file]
+ *
+ * Reads the source file from standard input unless a file path is given, in which case
+ * the file is memory mapped and lexed in place, or read in full first if it isn't a
+ * regular file, such as a pipe. With --stream, standard input is lexed as it is read
+ * rather than being read in full first. With --structural-index, the whole input is
+ * indexed up front and lexed with the structural index engine, so it can't be combined
+ * with --stream. Inputs that are entirely ASCII are lexed with the ASCII
+ * specialisation of the lexer. With --recover, lexing carries on past errors in the input
+ * and every one of them is reported at the end, instead of stopping at the first.
+ */
+int main(int argc, char **argv)
 {
   try
   {
-    ostringstream oss;
-    oss << cin.rdbuf();
+    bool stream = false;
+    unsigned int flags = PPLEX_DEFAULT;
+    string path;
+    size_t num_errors;
+
+    for(int i = 1; i < argc; i++)
+    {
+      string arg = argv[i];
 
-    preprocessor_lexer tokeniser(oss.str());
+      if(arg == "--stream")
+        stream = true;
+      else if(arg == "--structural-index")
+        flags |= PPLEX_STRUCTURAL_INDEX;
+      else if(arg == "--recover")
+        flags |= PPLEX_RECOVER_ERRORS;
+      else
+        path = arg;
+    }
 
-    while(!tokeniser.finished_tokenising())
+    if(stream
+       && !path.empty())
+      throw runtime_error("--stream lexes standard input, so cannot be given a file");
+
+    if(!path.empty())
     {
-      preprocessor_token tok = tokeniser.next_token();
+      mapped_file input(path);
+      num_errors = tokenise(input.data(), input.size(), flags);
     }
+    else if(stream)
+    {
+      ifstream input("/dev/stdin", ios::binary);
+
+      if(!input)
+        throw runtime_error("Unable to open standard input");
+
+      preprocessor_lexer tokeniser(input, preprocessor_lexer::default_stream_chunk_size, flags);
+      num_errors = tokenise(tokeniser);
+    }
+    else
+    {
+      //Read directly rather than through cin, as <iostream> would give the program a
+      //static initialiser
+      string input = read_file_descriptor(STDIN_FILENO, "standard input");
+      num_errors = tokenise(input.data(), input.length(), flags);
+    }
+
+    if(num_errors > 0)
+      return EXIT_FAILURE;
   }
   catch (exception& e)
   {
-    cerr << "ERROR: " << e.what() << endl;
+    fprintf(stderr, "ERROR: %s\n", e.what());
     return EXIT_FAILURE;
   }
   catch(...)
   {
-    cerr << "Exception" << endl;
+    fputs("Exception\n", stderr);
     return EXIT_FAILURE;
   }
 }
-
@@ -5,14 +5,12 @@
 #include <fstream>
 #include <stdexcept>
 #include <algorithm>
-#include <unordered_map>
 #include <unordered_set>
 #include <cassert>
 #include <memory>
 #include <cstring>
 #include <cstdint>
 #include <climits>
-#include <map>
 
 using namespace std;
 
@@ -78,31 +76,34 @@ template<> constexpr EFundamentalType FundamentalTypeOf<long double>() { return
 template<> constexpr EFundamentalType FundamentalTypeOf<void>() { return FT_VOID; }
 template<> constexpr EFundamentalType FundamentalTypeOf<nullptr_t>() { return FT_NULLPTR_T; }
 
-// convert EFundamentalType to a source code
-const map<EFundamentalType, string> FundamentalTypeToStringMap
+// convert EFundamentalType to a source code, indexed by EFundamentalType
+constexpr const char* FundamentalTypeToStringMap[] =
 {
-	{FT_SIGNED_CHAR, "signed char"},
-	{FT_SHORT_INT, "short int"},
-	{FT_INT, "int"},
-	{FT_LONG_INT, "long int"},
-	{FT_LONG_LONG_INT, "long long int"},
-	{FT_UNSIGNED_CHAR, "unsigned char"},
-	{FT_UNSIGNED_SHORT_INT, "unsigned short int"},
-	{FT_UNSIGNED_INT, "unsigned int"},
-	{FT_UNSIGNED_LONG_INT, "unsigned long int"},
-	{FT_UNSIGNED_LONG_LONG_INT, "unsigned long long int"},
-	{FT_WCHAR_T, "wchar_t"},
-	{FT_CHAR, "char"},
-	{FT_CHAR16_T, "char16_t"},
-	{FT_CHAR32_T, "char32_t"},
-	{FT_BOOL, "bool"},
-	{FT_FLOAT, "float"},
-	{FT_DOUBLE, "double"},
-	{FT_LONG_DOUBLE, "long double"},
-	{FT_VOID, "void"},
-	{FT_NULLPTR_T, "nullptr_t"}
+	"signed char", // FT_SIGNED_CHAR
+	"short int", // FT_SHORT_INT
+	"int", // FT_INT
+	"long int", // FT_LONG_INT
+	"long long int", // FT_LONG_LONG_INT
+	"unsigned char", // FT_UNSIGNED_CHAR
+	"unsigned short int", // FT_UNSIGNED_SHORT_INT
+	"unsigned int", // FT_UNSIGNED_INT
+	"unsigned long int", // FT_UNSIGNED_LONG_INT
+	"unsigned long long int", // FT_UNSIGNED_LONG_LONG_INT
+	"wchar_t", // FT_WCHAR_T
+	"char", // FT_CHAR
+	"char16_t", // FT_CHAR16_T
+	"char32_t", // FT_CHAR32_T
+	"bool", // FT_BOOL
+	"float", // FT_FLOAT
+	"double", // FT_DOUBLE
+	"long double", // FT_LONG_DOUBLE
+	"void", // FT_VOID
+	"nullptr_t" // FT_NULLPTR_T
 };
 
+static_assert(sizeof(FundamentalTypeToStringMap) / sizeof(FundamentalTypeToStringMap[0]) == FT_NULLPTR_T + 1,
+	"FundamentalTypeToStringMap must have an entry for every EFundamentalType");
+
 // token type enum for `simples`
 enum ETokenType
 {
@@ -233,14 +234,72 @@ enum ETokenType
 	OP_ARROW,
 };
 
-// StringToETokenTypeMap map of `simple` `preprocessing-tokens` to ETokenType
-const unordered_map<string, ETokenType> StringToTokenTypeMap =
+// spelling of a `simple` `preprocessing-token` and its ETokenType
+struct StringToTokenTypeEntry
 {
-	// keywords
+	const char* spelling;
+	ETokenType token_type;
+};
+
+// StringToTokenTypeMap map of `simple` `preprocessing-tokens` to ETokenType, sorted by
+// spelling so that it can be binary searched
+constexpr StringToTokenTypeEntry StringToTokenTypeMap[] =
+{
+	{"!", OP_LNOT},
+	{"!=", OP_NE},
+	{"%", OP_MOD},
+	{"%=", OP_MODASS},
+	{"%>", OP_RBRACE},
+	{"&", OP_AMP},
+	{"&&", OP_LAND},
+	{"&=", OP_BANDASS},
+	{"(", OP_LPAREN},
+	{")", OP_RPAREN},
+	{"*", OP_STAR},
+	{"*=", OP_STARASS},
+	{"+", OP_PLUS},
+	{"++", OP_INC},
+	{"+=", OP_PLUSASS},
+	{",", OP_COMMA},
+	{"-", OP_MINUS},
+	{"--", OP_DEC},
+	{"-=", OP_MINUSASS},
+	{"->", OP_ARROW},
+	{"->*", OP_ARROWSTAR},
+	{".", OP_DOT},
+	{".*", OP_DOTSTAR},
+	{"...", OP_DOTS},
+	{"/", OP_DIV},
+	{"/=", OP_DIVASS},
+	{":", OP_COLON},
+	{"::", OP_COLON2},
+	{":>", OP_RSQUARE},
+	{";", OP_SEMICOLON},
+	{"<", OP_LT},
+	{"<%", OP_LBRACE},
+	{"<:", OP_LSQUARE},
+	{"<<", OP_LSHIFT},
+	{"<<=", OP_LSHIFTASS},
+	{"<=", OP_LE},
+	{"=", OP_ASS},
+	{"==", OP_EQ},
+	{">", OP_GT},
+	{">=", OP_GE},
+	{">>", OP_RSHIFT},
+	{">>=", OP_RSHIFTASS},
+	{"?", OP_QMARK},
+	{"[", OP_LSQUARE},
+	{"]", OP_RSQUARE},
+	{"^", OP_XOR},
+	{"^=", OP_XORASS},
 	{"alignas", KW_ALIGNAS},
 	{"alignof", KW_ALIGNOF},
+	{"and", OP_LAND},
+	{"and_eq", OP_BANDASS},
 	{"asm", KW_ASM},
 	{"auto", KW_AUTO},
+	{"bitand", OP_AMP},
+	{"bitor", OP_BOR},
 	{"bool", KW_BOOL},
 	{"break", KW_BREAK},
 	{"case", KW_CASE},
@@ -249,9 +308,10 @@ const unordered_map<string, ETokenType> StringToTokenTypeMap =
 	{"char16_t", KW_CHAR16_T},
 	{"char32_t", KW_CHAR32_T},
 	{"class", KW_CLASS},
+	{"compl", OP_COMPL},
 	{"const", KW_CONST},
-	{"constexpr", KW_CONSTEXPR},
 	{"const_cast", KW_CONST_CAST},
+	{"constexpr", KW_CONSTEXPR},
 	{"continue", KW_CONTINUE},
 	{"decltype", KW_DECLTYPE},
 	{"default", KW_DEFAULT},
@@ -277,8 +337,12 @@ const unordered_map<string, ETokenType> StringToTokenTypeMap =
 	{"namespace", KW_NAMESPACE},
 	{"new", KW_NEW},
 	{"noexcept", KW_NOEXCEPT},
+	{"not", OP_LNOT},
+	{"not_eq", OP_NE},
 	{"nullptr", KW_NULLPTR},
 	{"operator", KW_OPERATOR},
+	{"or", OP_LOR},
+	{"or_eq", OP_BORASS},
 	{"private", KW_PRIVATE},
 	{"protected", KW_PROTECTED},
 	{"public", KW_PUBLIC},
@@ -310,201 +374,185 @@ const unordered_map<string, ETokenType> StringToTokenTypeMap =
 	{"volatile", KW_VOLATILE},
 	{"wchar_t", KW_WCHAR_T},
 	{"while", KW_WHILE},
-
-	// operators/punctuation
-	{"{", OP_LBRACE},
-	{"<%", OP_LBRACE},
-	{"}", OP_RBRACE},
-	{"%>", OP_RBRACE},
-	{"[", OP_LSQUARE},
-	{"<:", OP_LSQUARE},
-	{"]", OP_RSQUARE},
-	{":>", OP_RSQUARE},
-	{"(", OP_LPAREN},
-	{")", OP_RPAREN},
-	{"|", OP_BOR},
-	{"bitor", OP_BOR},
-	{"^", OP_XOR},
 	{"xor", OP_XOR},
-	{"~", OP_COMPL},
-	{"compl", OP_COMPL},
-	{"&", OP_AMP},
-	{"bitand", OP_AMP},
-	{"!", OP_LNOT},
-	{"not", OP_LNOT},
-	{";", OP_SEMICOLON},
-	{":", OP_COLON},
-	{"...", OP_DOTS},
-	{"?", OP_QMARK},
-	{"::", OP_COLON2},
-	{".", OP_DOT},
-	{".*", OP_DOTSTAR},
-	{"+", OP_PLUS},
-	{"-", OP_MINUS},
-	{"*", OP_STAR},
-	{"/", OP_DIV},
-	{"%", OP_MOD},
-	{"=", OP_ASS},
-	{"<", OP_LT},
-	{">", OP_GT},
-	{"+=", OP_PLUSASS},
-	{"-=", OP_MINUSASS},
-	{"*=", OP_STARASS},
-	{"/=", OP_DIVASS},
-	{"%=", OP_MODASS},
-	{"^=", OP_XORASS},
 	{"xor_eq", OP_XORASS},
-	{"&=", OP_BANDASS},
-	{"and_eq", OP_BANDASS},
+	{"{", OP_LBRACE},
+	{"|", OP_BOR},
 	{"|=", OP_BORASS},
-	{"or_eq", OP_BORASS},
-	{"<<", OP_LSHIFT},
-	{">>", OP_RSHIFT},
-	{">>=", OP_RSHIFTASS},
-	{"<<=", OP_LSHIFTASS},
-	{"==", OP_EQ},
-	{"!=", OP_NE},
-	{"not_eq", OP_NE},
-	{"<=", OP_LE},
-	{">=", OP_GE},
-	{"&&", OP_LAND},
-	{"and", OP_LAND},
 	{"||", OP_LOR},
-	{"or", OP_LOR},
-	{"++", OP_INC},
-	{"--", OP_DEC},
-	{",", OP_COMMA},
-	{"->*", OP_ARROWSTAR},
-	{"->", OP_ARROW}
+	{"}", OP_RBRACE},
+	{"~", OP_COMPL}
 };
 
-// map of enum to string
-const map<ETokenType, string> TokenTypeToStringMap =
+// compare two spellings as strcmp does, at compile time
+constexpr int CompareSpellings(const char* a, const char* b)
+{
+	while (*a && *a == *b)
+	{
+		++a;
+		++b;
+	}
+
+	return (unsigned char)*a - (unsigned char)*b;
+}
+
+// check StringToTokenTypeMap is strictly sorted by spelling
+constexpr bool StringToTokenTypeMapIsSorted()
+{
+	for (size_t i = 1; i < sizeof(StringToTokenTypeMap) / sizeof(StringToTokenTypeMap[0]); i++)
+	{
+		if (CompareSpellings(StringToTokenTypeMap[i - 1].spelling, StringToTokenTypeMap[i].spelling) >= 0)
+			return false;
+	}
+
+	return true;
+}
+
+static_assert(StringToTokenTypeMapIsSorted(), "StringToTokenTypeMap must be sorted by spelling");
+
+// look up the ETokenType of a `simple` spelling, returning false if it isn't one
+bool StringToTokenType(const string& spelling, ETokenType& token_type)
 {
-	{KW_ALIGNAS, "KW_ALIGNAS"},
-	{KW_ALIGNOF, "KW_ALIGNOF"},
-	{KW_ASM, "KW_ASM"},
-	{KW_AUTO, "KW_AUTO"},
-	{KW_BOOL, "KW_BOOL"},
-	{KW_BREAK, "KW_BREAK"},
-	{KW_CASE, "KW_CASE"},
-	{KW_CATCH, "KW_CATCH"},
-	{KW_CHAR, "KW_CHAR"},
-	{KW_CHAR16_T, "KW_CHAR16_T"},
-	{KW_CHAR32_T, "KW_CHAR32_T"},
-	{KW_CLASS, "KW_CLASS"},
-	{KW_CONST, "KW_CONST"},
-	{KW_CONSTEXPR, "KW_CONSTEXPR"},
-	{KW_CONST_CAST, "KW_CONST_CAST"},
-	{KW_CONTINUE, "KW_CONTINUE"},
-	{KW_DECLTYPE, "KW_DECLTYPE"},
-	{KW_DEFAULT, "KW_DEFAULT"},
-	{KW_DELETE, "KW_DELETE"},
-	{KW_DO, "KW_DO"},
-	{KW_DOUBLE, "KW_DOUBLE"},
-	{KW_DYNAMIC_CAST, "KW_DYNAMIC_CAST"},
-	{KW_ELSE, "KW_ELSE"},
-	{KW_ENUM, "KW_ENUM"},
-	{KW_EXPLICIT, "KW_EXPLICIT"},
-	{KW_EXPORT, "KW_EXPORT"},
-	{KW_EXTERN, "KW_EXTERN"},
-	{KW_FALSE, "KW_FALSE"},
-	{KW_FLOAT, "KW_FLOAT"},
-	{KW_FOR, "KW_FOR"},
-	{KW_FRIEND, "KW_FRIEND"},
-	{KW_GOTO, "KW_GOTO"},
-	{KW_IF, "KW_IF"},
-	{KW_INLINE, "KW_INLINE"},
-	{KW_INT, "KW_INT"},
-	{KW_LONG, "KW_LONG"},
-	{KW_MUTABLE, "KW_MUTABLE"},
-	{KW_NAMESPACE, "KW_NAMESPACE"},
-	{KW_NEW, "KW_NEW"},
-	{KW_NOEXCEPT, "KW_NOEXCEPT"},
-	{KW_NULLPTR, "KW_NULLPTR"},
-	{KW_OPERATOR, "KW_OPERATOR"},
-	{KW_PRIVATE, "KW_PRIVATE"},
-	{KW_PROTECTED, "KW_PROTECTED"},
-	{KW_PUBLIC, "KW_PUBLIC"},
-	{KW_REGISTER, "KW_REGISTER"},
-	{KW_REINTERPET_CAST, "KW_REINTERPET_CAST"},
-	{KW_RETURN, "KW_RETURN"},
-	{KW_SHORT, "KW_SHORT"},
-	{KW_SIGNED, "KW_SIGNED"},
-	{KW_SIZEOF, "KW_SIZEOF"},
-	{KW_STATIC, "KW_STATIC"},
-	{KW_STATIC_ASSERT, "KW_STATIC_ASSERT"},
-	{KW_STATIC_CAST, "KW_STATIC_CAST"},
-	{KW_STRUCT, "KW_STRUCT"},
-	{KW_SWITCH, "KW_SWITCH"},
-	{KW_TEMPLATE, "KW_TEMPLATE"},
-	{KW_THIS, "KW_THIS"},
-	{KW_THREAD_LOCAL, "KW_THREAD_LOCAL"},
-	{KW_THROW, "KW_THROW"},
-	{KW_TRUE, "KW_TRUE"},
-	{KW_TRY, "KW_TRY"},
-	{KW_TYPEDEF, "KW_TYPEDEF"},
-	{KW_TYPEID, "KW_TYPEID"},
-	{KW_TYPENAME, "KW_TYPENAME"},
-	{KW_UNION, "KW_UNION"},
-	{KW_UNSIGNED, "KW_UNSIGNED"},
-	{KW_USING, "KW_USING"},
-	{KW_VIRTUAL, "KW_VIRTUAL"},
-	{KW_VOID, "KW_VOID"},
-	{KW_VOLATILE, "KW_VOLATILE"},
-	{KW_WCHAR_T, "KW_WCHAR_T"},
-	{KW_WHILE, "KW_WHILE"},
-	{OP_LBRACE, "OP_LBRACE"},
-	{OP_RBRACE, "OP_RBRACE"},
-	{OP_LSQUARE, "OP_LSQUARE"},
-	{OP_RSQUARE, "OP_RSQUARE"},
-	{OP_LPAREN, "OP_LPAREN"},
-	{OP_RPAREN, "OP_RPAREN"},
-	{OP_BOR, "OP_BOR"},
-	{OP_XOR, "OP_XOR"},
-	{OP_COMPL, "OP_COMPL"},
-	{OP_AMP, "OP_AMP"},
-	{OP_LNOT, "OP_LNOT"},
-	{OP_SEMICOLON, "OP_SEMICOLON"},
-	{OP_COLON, "OP_COLON"},
-	{OP_DOTS, "OP_DOTS"},
-	{OP_QMARK, "OP_QMARK"},
-	{OP_COLON2, "OP_COLON2"},
-	{OP_DOT, "OP_DOT"},
-	{OP_DOTSTAR, "OP_DOTSTAR"},
-	{OP_PLUS, "OP_PLUS"},
-	{OP_MINUS, "OP_MINUS"},
-	{OP_STAR, "OP_STAR"},
-	{OP_DIV, "OP_DIV"},
-	{OP_MOD, "OP_MOD"},
-	{OP_ASS, "OP_ASS"},
-	{OP_LT, "OP_LT"},
-	{OP_GT, "OP_GT"},
-	{OP_PLUSASS, "OP_PLUSASS"},
-	{OP_MINUSASS, "OP_MINUSASS"},
-	{OP_STARASS, "OP_STARASS"},
-	{OP_DIVASS, "OP_DIVASS"},
-	{OP_MODASS, "OP_MODASS"},
-	{OP_XORASS, "OP_XORASS"},
-	{OP_BANDASS, "OP_BANDASS"},
-	{OP_BORASS, "OP_BORASS"},
-	{OP_LSHIFT, "OP_LSHIFT"},
-	{OP_RSHIFT, "OP_RSHIFT"},
-	{OP_RSHIFTASS, "OP_RSHIFTASS"},
-	{OP_LSHIFTASS, "OP_LSHIFTASS"},
-	{OP_EQ, "OP_EQ"},
-	{OP_NE, "OP_NE"},
-	{OP_LE, "OP_LE"},
-	{OP_GE, "OP_GE"},
-	{OP_LAND, "OP_LAND"},
-	{OP_LOR, "OP_LOR"},
-	{OP_INC, "OP_INC"},
-	{OP_DEC, "OP_DEC"},
-	{OP_COMMA, "OP_COMMA"},
-	{OP_ARROWSTAR, "OP_ARROWSTAR"},
-	{OP_ARROW, "OP_ARROW"}
+	auto entry = lower_bound(begin(StringToTokenTypeMap), end(StringToTokenTypeMap), spelling,
+		[](const StringToTokenTypeEntry& entry, const string& s) { return CompareSpellings(entry.spelling, s.c_str()) < 0; });
+
+	if (entry == end(StringToTokenTypeMap) || spelling != entry->spelling)
+		return false;
+
+	token_type = entry->token_type;
+	return true;
+}
+
+// map of enum to string, indexed by ETokenType
+constexpr const char* TokenTypeToStringMap[] =
+{
+	"KW_ALIGNAS",
+	"KW_ALIGNOF",
+	"KW_ASM",
+	"KW_AUTO",
+	"KW_BOOL",
+	"KW_BREAK",
+	"KW_CASE",
+	"KW_CATCH",
+	"KW_CHAR",
+	"KW_CHAR16_T",
+	"KW_CHAR32_T",
+	"KW_CLASS",
+	"KW_CONST",
+	"KW_CONSTEXPR",
+	"KW_CONST_CAST",
+	"KW_CONTINUE",
+	"KW_DECLTYPE",
+	"KW_DEFAULT",
+	"KW_DELETE",
+	"KW_DO",
+	"KW_DOUBLE",
+	"KW_DYNAMIC_CAST",
+	"KW_ELSE",
+	"KW_ENUM",
+	"KW_EXPLICIT",
+	"KW_EXPORT",
+	"KW_EXTERN",
+	"KW_FALSE",
+	"KW_FLOAT",
+	"KW_FOR",
+	"KW_FRIEND",
+	"KW_GOTO",
+	"KW_IF",
+	"KW_INLINE",
+	"KW_INT",
+	"KW_LONG",
+	"KW_MUTABLE",
+	"KW_NAMESPACE",
+	"KW_NEW",
+	"KW_NOEXCEPT",
+	"KW_NULLPTR",
+	"KW_OPERATOR",
+	"KW_PRIVATE",
+	"KW_PROTECTED",
+	"KW_PUBLIC",
+	"KW_REGISTER",
+	"KW_REINTERPET_CAST",
+	"KW_RETURN",
+	"KW_SHORT",
+	"KW_SIGNED",
+	"KW_SIZEOF",
+	"KW_STATIC",
+	"KW_STATIC_ASSERT",
+	"KW_STATIC_CAST",
+	"KW_STRUCT",
+	"KW_SWITCH",
+	"KW_TEMPLATE",
+	"KW_THIS",
+	"KW_THREAD_LOCAL",
+	"KW_THROW",
+	"KW_TRUE",
+	"KW_TRY",
+	"KW_TYPEDEF",
+	"KW_TYPEID",
+	"KW_TYPENAME",
+	"KW_UNION",
+	"KW_UNSIGNED",
+	"KW_USING",
+	"KW_VIRTUAL",
+	"KW_VOID",
+	"KW_VOLATILE",
+	"KW_WCHAR_T",
+	"KW_WHILE",
+	"OP_LBRACE",
+	"OP_RBRACE",
+	"OP_LSQUARE",
+	"OP_RSQUARE",
+	"OP_LPAREN",
+	"OP_RPAREN",
+	"OP_BOR",
+	"OP_XOR",
+	"OP_COMPL",
+	"OP_AMP",
+	"OP_LNOT",
+	"OP_SEMICOLON",
+	"OP_COLON",
+	"OP_DOTS",
+	"OP_QMARK",
+	"OP_COLON2",
+	"OP_DOT",
+	"OP_DOTSTAR",
+	"OP_PLUS",
+	"OP_MINUS",
+	"OP_STAR",
+	"OP_DIV",
+	"OP_MOD",
+	"OP_ASS",
+	"OP_LT",
+	"OP_GT",
+	"OP_PLUSASS",
+	"OP_MINUSASS",
+	"OP_STARASS",
+	"OP_DIVASS",
+	"OP_MODASS",
+	"OP_XORASS",
+	"OP_BANDASS",
+	"OP_BORASS",
+	"OP_LSHIFT",
+	"OP_RSHIFT",
+	"OP_RSHIFTASS",
+	"OP_LSHIFTASS",
+	"OP_EQ",
+	"OP_NE",
+	"OP_LE",
+	"OP_GE",
+	"OP_LAND",
+	"OP_LOR",
+	"OP_INC",
+	"OP_DEC",
+	"OP_COMMA",
+	"OP_ARROWSTAR",
+	"OP_ARROW"
 };
 
+static_assert(sizeof(TokenTypeToStringMap) / sizeof(TokenTypeToStringMap[0]) == OP_ARROW + 1,
+	"TokenTypeToStringMap must have an entry for every ETokenType");
+
 // convert integer [0,15] to hexadecimal digit
 char ValueToHexChar(int c)
 {
@@ -530,20 +578,28 @@ char ValueToHexChar(int c)
 	}
 }
 
-// hex dump memory range
-string HexDump(const void* pdata, size_t nbytes)
+// hex dump memory range, written straight to the output stream without building a string
+struct HexDump
 {
-	unsigned char* p = (unsigned char*) pdata;
+	HexDump(const void* pdata, size_t nbytes)
+		: pdata(pdata), nbytes(nbytes)
+	{}
+
+	const void* pdata;
+	size_t nbytes;
+};
 
-	string s(nbytes*2, '?');
+ostream& operator<<(ostream& out, const HexDump& dump)
+{
+	const unsigned char* p = (const unsigned char*) dump.pdata;
 
-	for (size_t i = 0; i < nbytes; i++)
+	for (size_t i = 0; i < dump.nbytes; i++)
 	{
-		s[2*i+0] = ValueToHexChar((p[i] & 0xF0) >> 4);
-		s[2*i+1] = ValueToHexChar((p[i] & 0x0F) >> 0);
+		out.put(ValueToHexChar((p[i] & 0xF0) >> 4));
+		out.put(ValueToHexChar((p[i] & 0x0F) >> 0));
 	}
 
-	return s;
+	return out;
 }
 
 // DebugPostTokenOutputStream: helper class to produce PA2 output format
@@ -558,7 +614,7 @@ struct DebugPostTokenOutputStream
 	// output: simple <source> <token_type>
 	void emit_simple(const string& source, ETokenType token_type)
 	{
-		cout << "simple " << source << " " << TokenTypeToStringMap.at(token_type) << endl;
+		cout << "simple " << source << " " << TokenTypeToStringMap[token_type] << endl;
 	}
 
 	// output: identifier <source>
@@ -570,25 +626,25 @@ struct DebugPostTokenOutputStream
 	// output: literal <source> <type> <hexdump(data,nbytes)>
 	void emit_literal(const string& source, EFundamentalType type, const void* data, size_t nbytes)
 	{
-		cout << "literal " << source << " " << FundamentalTypeToStringMap.at(type) << " " << HexDump(data, nbytes) << endl;
+		cout << "literal " << source << " " << FundamentalTypeToStringMap[type] << " " << HexDump(data, nbytes) << endl;
 	}
 
 	// output: literal <source> array of <num_elements> <type> <hexdump(data,nbytes)>
 	void emit_literal_array(const string& source, size_t num_elements, EFundamentalType type, const void* data, size_t nbytes)
 	{
-		cout << "literal " << source << " array of " << num_elements << " " << FundamentalTypeToStringMap.at(type) << " " << HexDump(data, nbytes) << endl;
+		cout << "literal " << source << " array of " << num_elements << " " << FundamentalTypeToStringMap[type] << " " << HexDump(data, nbytes) << endl;
 	}
 
 	// output: user-defined-literal <source> <ud_suffix> character <type> <hexdump(data,nbytes)>
 	void emit_user_defined_literal_character(const string& source, const string& ud_suffix, EFundamentalType type, const void* data, size_t nbytes)
 	{
-		cout << "user-defined-literal " << source << " " << ud_suffix << " character " << FundamentalTypeToStringMap.at(type) << " " << HexDump(data, nbytes) << endl;
+		cout << "user-defined-literal " << source << " " << ud_suffix << " character " << FundamentalTypeToStringMap[type] << " " << HexDump(data, nbytes) << endl;
 	}
 
 	// output: user-defined-literal <source> <ud_suffix> string array of <num_elements> <type> <hexdump(data, nbytes)>
 	void emit_user_defined_literal_string_array(const string& source, const string& ud_suffix, size_t num_elements, EFundamentalType type, const void* data, size_t nbytes)
 	{
-		cout << "user-defined-literal " << source << " " << ud_suffix << " string array of " << num_elements << " " << FundamentalTypeToStringMap.at(type) << " " << HexDump(data, nbytes) << endl;
+		cout << "user-defined-literal " << source << " " << ud_suffix << " string array of " << num_elements << " " << FundamentalTypeToStringMap[type] << " " << HexDump(data, nbytes) << endl;
 	}
 
 	// output: user-defined-literal <source> <ud_suffix> <prefix>
@@ -0,0 +1,302 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+using namespace std;
+
+#include "preprocessor/preprocessor_lexer.h"
+#include "util/byte_scan.h"
+
+//Lexes each input with every lexing engine and checks they all produce the same tokens
+//with the same spellings as the default engine. The inputs are made of the things the
+//engines handle differently: trigraphs, universal-character-names, line splices, raw
+//strings, header names and text outside the basic source character set.
+//
+//Line splices are deleted before the input is split into tokens, so most inputs are
+//also lexed with their splices deleted up front, which must give the same tokens.
+
+//Streamed input is read in the smallest chunks the lexer allows, so that tokens straddle
+//the refills of its window
+const size_t stream_chunk_size = 1;
+
+//An input to lex, whether it has errors, in which case only the engines which recover
+//from errors can be compared, and whether deleting its splices up front gives the same
+//tokens, which isn't so for a splice in a raw string, a universal-character-name or an
+//error
+struct engine_test_input
+{
+  const char *name;
+  const char *source;
+  bool has_errors;
+  bool splices_deletable;
+};
+
+const engine_test_input inputs[] =
+{
+  { "trigraphs",
+    "?\?=define ARRAY(x) x?\?(0?\?) ?\?' 1\n"
+    "int a?\?<?\?> = ?\?< 1, ?\?-2 ?\?>;\n"
+    "b ?\?!= c ?\?!?\?! d;\n"
+    "\"?\?/\"\" '?\?/'' \"?\?) ?\?? ?? ?\?\?=\";\n"
+    "?\?=?\?= %:%: <: :> <% %>\n"
+    "x ?\?/\n"
+    "y\n", false, true },
+
+  { "universal-character-names",
+    "int \\u00e9t\\u00E9 = 1;\n"
+    "\\U0001F600smile = \\u0041;\n"
+    "\"\\u00e9\\U0001F600\" u8'\\u0041' L\"\\u00e9\";\n"
+    "x\\u1 y\\U0001F6 z\\u00\xC3\xA9 \\ \\u;\n"
+    "\"\\u\xC3\xA9\" '\\u'\n"
+    "a\\\n\\u00e9b c\\u00\\\ne9d\n", false, false },
+
+  { "line splices",
+    "in\\\nt x = 1\\\n2;\n"
+    "#def\\\nine Y \\\n  value\n"
+    "\"str\\\ning\" 'a\\\n'\n"
+    "// a comment \\\n continued\n"
+    "/\\\n* block *\\\n/ z\n"
+    "/\\\n\\\n/ line comment\n"
+    "a +\\\n= b;\n"
+    "L\"wide\\\n\" u8\"ut\\\nf8\"\n"
+    "#include \\\n<spliced.h>\n"
+    "end\\\n", false, true },
+
+  { "line splices in lookahead",
+    ".\\\n5 .\\\n\\\nx ..\\\n. ..\\\nx\n"
+    "R\\\n\"(x)\" u\\\n8\"x\" u8\\\nR\"(y)\" L\\\n'x' U\\\nR\"(z)\"\n"
+    "<:\\\n:x <:\\\n:> <::\\\n> %:\\\n%:\n"
+    "a ?\?/\n.?\?/\n5 <?\?/\n:\\\n:y\n"
+    "#include <\\\nx.h>\n"
+    "#include \\\n<\\\n\\\ny.h>\n", false, true },
+
+  { "raw strings",
+    "R\"(simple)\" R\"()\"\n"
+    "R\"(a\\\nb ?\?= \\u00e9 /* c */)\"\n"
+    "R\"x(?\?=)\")x\"\n"
+    "u8R\"(\xCF\x80)\" LR\"--(\")--\" uR\"(u)\" UR\"(U)\"\n"
+    "R\"(a)\"_suffix R\"(b)\"R\"(c)\" x R\"(d)\"y\n"
+    "R\"#(\n"
+    ")?\?=\"\n"
+    ")#\";\n"
+    "R x R \"\"\n"
+    "#include R\"(not a header)\"\n", false, false },
+
+  { "non-ASCII text",
+    "int caf\xC3\xA9 = 1; // \xC3\xBCn\xC3\xAF\x63\xC3\xB6\x64\xC3\xA9 comment\n"
+    "/* \xE6\x97\xA5\xE6\x9C\xAC */ x = \"\xCF\x80\xF0\x9D\x84\x9E\";\n"
+    "'\xC3\xA9' u8\"\xE2\x82\xAC\" \xE2\x82\xAC\n"
+    "\xCE\xB1\xCE\xB2\xCE\xB3 = \xCE\xB1 + \xCE\xB2;\n"
+    "#include <\xC3\xA9.h>\n"
+    "\xC2\xA0 a\xE2\x80\x8B b\n", false, true },
+
+  { "header names",
+    "#include <vector>\n"
+    "#include \"a b.h\"\n"
+    " # include <sys/types.h>\n"
+    "%:include <x?\?/y.h>\n"
+    "#include \"a/*b*/c.h\"\n"
+    "#include /* comment */ <after_comment.h>\n"
+    "#if a < b > c\n"
+    "#endif\n"
+    "include <not_a_header>\n"
+    "#define include <x>\n", false, true },
+
+  { "errors",
+    "ok \"unterminated\n"
+    "'x\n"
+    "bad \xC0\x80 utf8 \xFF\n"
+    "R\"a b(x)a b\" R\"abcdefghijklmnopq(x)abcdefghijklmnopq\"\n"
+    "#include <unterminated\n"
+    "#include <a//b.h>\n"
+    "#include \"new\n"
+    "line.h>\n"
+    "R\"(unterminated raw\n", true, false },
+
+  { "unterminated comment",
+    "a \xE2\x82\xAC /* unterminated ?\?/\n"
+    "\xE2\x82", true, false }
+};
+
+//The engines to compare, each a way of constructing and driving the lexer
+enum lexing_engine
+{
+  ENGINE_DEFAULT = 0,
+  ENGINE_STRUCTURAL_INDEX,
+  ENGINE_NO_CLEAN_BLOCKS,
+  ENGINE_ASCII,
+  ENGINE_ASCII_STRUCTURAL_INDEX,
+  ENGINE_STREAM,
+  ENGINE_SPLICES_DELETED,
+  NUM_ENGINES
+};
+
+const char *const engine_names[NUM_ENGINES] =
+{
+  "default",
+  "structural index",
+  "no clean blocks",
+  "ascii",
+  "ascii structural index",
+  "stream",
+  "splices deleted"
+};
+
+const unsigned int engine_flags[NUM_ENGINES] =
+{
+  PPLEX_DEFAULT,
+  PPLEX_STRUCTURAL_INDEX,
+  PPLEX_NO_CLEAN_BLOCK_FAST_PATH,
+  PPLEX_DEFAULT,
+  PPLEX_STRUCTURAL_INDEX,
+  PPLEX_DEFAULT,
+  PPLEX_DEFAULT
+};
+
+/**
+ * Lexes the whole of the input, returning each token as its type and spelling, followed
+ * by each error the lexer recovered from.
+ */
+template<typename Lexer>
+vector<string> lex_all(Lexer &lexer)
+{
+  vector<string> tokens;
+
+  while(!lexer.finished_tokenising())
+  {
+    preprocessor_token tok = lexer.next_token();
+    tokens.push_back(to_string(tok.type) + " [" + lexer.spelling(tok).str() + "]");
+  }
+
+  for(const preprocessor_diagnostic &diagnostic : lexer.diagnostics())
+    tokens.push_back("error " + diagnostic.message());
+
+  return tokens;
+}
+
+/**
+ * Deletes each backslash or ??/ which is followed by a new-line, along with the new-line.
+ */
+string delete_line_splices(const string &source)
+{
+  string spliced;
+
+  for(size_t i = 0; i < source.length(); i++)
+  {
+    if(source.compare(i, 2, "\\\n") == 0)
+      i += 1;
+    else if(source.compare(i, 4, "?\?/\n") == 0)
+      i += 3;
+    else
+      spliced += source[i];
+  }
+
+  return spliced;
+}
+
+/**
+ * Lexes the input with the specified engine.
+ */
+vector<string> lex_with_engine(const string &source, lexing_engine engine, unsigned int flags)
+{
+  flags |= engine_flags[engine];
+
+  if(engine == ENGINE_STREAM)
+  {
+    istringstream source_stream(source);
+    preprocessor_lexer lexer(source_stream, stream_chunk_size, flags);
+    return lex_all(lexer);
+  }
+  else if(engine == ENGINE_ASCII
+          || engine == ENGINE_ASCII_STRUCTURAL_INDEX)
+  {
+    ascii_preprocessor_lexer lexer(source.data(), source.length(), flags);
+    return lex_all(lexer);
+  }
+  else if(engine == ENGINE_SPLICES_DELETED)
+  {
+    string spliced = delete_line_splices(source);
+    preprocessor_lexer lexer(spliced.data(), spliced.length(), flags);
+    return lex_all(lexer);
+  }
+  else
+  {
+    preprocessor_lexer lexer(source.data(), source.length(), flags);
+    return lex_all(lexer);
+  }
+}
+
+/**
+ * Reports the first token at which the tokens from an engine differ from those of the
+ * default engine.
+ */
+void report_mismatch(const engine_test_input &input, lexing_engine engine,
+                     const vector<string> &expected, const vector<string> &actual)
+{
+  size_t i = 0;
+
+  while(i < expected.size()
+        && i < actual.size()
+        && expected[i] == actual[i])
+    i++;
+
+  cout << "FAIL: " << input.name << ": " << engine_names[engine]
+       << " differs from default at token " << i << endl;
+  cout << "  default: " << (i < expected.size() ? expected[i] : "<end>") << endl;
+  cout << "  " << engine_names[engine] << ": " << (i < actual.size() ? actual[i] : "<end>") << endl;
+}
+
+/**
+ * Lexes every input with every engine, recovering from errors in the inputs which have
+ * them, and fails if any engine produces different tokens or errors from the default.
+ * The ASCII engines only lex the inputs which are entirely ASCII, and the inputs are only
+ * lexed with their splices deleted where that can't change their tokens.
+ */
+int main()
+{
+  bool failed = false;
+
+  for(const engine_test_input &input : inputs)
+  {
+    string source = input.source;
+    unsigned int flags = input.has_errors ? PPLEX_RECOVER_ERRORS : PPLEX_DEFAULT;
+    bool ascii = is_ascii_source(source.data(), source.length());
+    vector<string> expected;
+
+    for(int engine = ENGINE_DEFAULT; engine < NUM_ENGINES; engine++)
+    {
+      if(!ascii
+         && (engine == ENGINE_ASCII
+             || engine == ENGINE_ASCII_STRUCTURAL_INDEX))
+        continue;
+
+      if(!input.splices_deletable
+         && engine == ENGINE_SPLICES_DELETED)
+        continue;
+
+      vector<string> actual;
+
+      try
+      {
+        actual = lex_with_engine(source, (lexing_engine)engine, flags);
+      }
+      catch(exception &e)
+      {
+        actual.push_back(string("exception ") + e.what());
+      }
+
+      if(engine == ENGINE_DEFAULT)
+        expected = actual;
+      else if(actual != expected)
+      {
+        report_mismatch(input, (lexing_engine)engine, expected, actual);
+        failed = true;
+      }
+    }
+  }
+
+  cout << (failed ? "lexing engines differ" : "all lexing engines agree") << endl;
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}